@@ -0,0 +1,738 @@
+#include "Ec21Emulator.h"
+
+#define DEFAULT_BAUD		(115200)
+#define SEND_SIZE_MAX		(1460)
+#define READ_SIZE_MAX		(1500)
+#define PWR_KEY_PULSE_MIN	(100)	// [msec.]
+#define POWER_DOWN_TIME		(1000)	// [msec.]
+
+#define REVISION			"EC21JFAR06A03M4G"
+#define IMEI				"866000000000001"
+#define IMSI				"440100000000001"
+#define ICCID				"8981100000000000001F"
+#define PHONE_NUMBER		"09012345678"
+
+static std::vector<std::string> SplitArguments(const std::string& args)
+{
+	std::vector<std::string> result;
+	std::string arg;
+	bool quoted = false;
+	for (size_t i = 0; i < args.size(); i++) {
+		char c = args[i];
+		if (c == '"') {
+			quoted = !quoted;
+		}
+		else if (c == ',' && !quoted) {
+			result.push_back(arg);
+			arg.clear();
+		}
+		else {
+			arg += c;
+		}
+	}
+	if (args.size() >= 1) result.push_back(arg);
+
+	return result;
+}
+
+static std::vector<std::string> SplitCommands(const std::string& line)
+{
+	std::vector<std::string> result;
+	std::string command;
+	bool quoted = false;
+	for (size_t i = 0; i < line.size(); i++) {
+		char c = line[i];
+		if (c == '"') quoted = !quoted;
+		if (c == ';' && !quoted) {
+			result.push_back(command);
+			command.clear();
+		}
+		else {
+			command += c;
+		}
+	}
+	result.push_back(command);
+
+	return result;
+}
+
+static void AppendLine(std::string* out, const std::string& line)
+{
+	*out += "\r\n" + line + "\r\n";
+}
+
+static int ArgumentAsInt(const std::vector<std::string>& args, size_t index, int defaultValue)
+{
+	return index < args.size() ? atoi(args[index].c_str()) : defaultValue;
+}
+
+Ec21Emulator::Ec21Emulator(HardwareSerial& serial) :
+	_Serial(serial),
+	_Supply(false),
+	_On(false),
+	_PwrKeyHigh(false),
+	_PwrKeyTime(0),
+	_ResetFromOn(false),
+	_Baud(DEFAULT_BAUD),
+	_SavedBaud(DEFAULT_BAUD),
+	_Echo(true),
+	_Mode(MODE_COMMAND),
+	_DataSize(0),
+	_CregN(0),
+	_CgregN(0),
+	_CeregN(0),
+	_RegistrationStat(0),
+	_NetworkStat(1),
+	_SimReady(true),
+	_ContextActive(false),
+	_GnssOn(false),
+	_SmsFormat(0),
+	_CnmiMt(1),
+	_OpenResult(0),
+	_HttpStatus(200),
+	_BootTime(5000),
+	_RegistrationTime(2000),
+	_ResponseLatency(5),
+	_OpenLatency(300),
+	_SendLatency(20),
+	_AckDelay(100),
+	_HttpLatency(500)
+{
+	for (int i = 0; i < CONNECT_ID_NUM; i++) _Sockets[i].Used = false;
+	_Serial.SetPeer(this);
+}
+
+Ec21Emulator::~Ec21Emulator()
+{
+	_Serial.SetPeer(NULL);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////
+// HostDevice
+
+void Ec21Emulator::Process(unsigned long long nowMicros)
+{
+	while (_Events.size() >= 1 && _Events.begin()->first <= nowMicros) {
+		std::function<void()> func = _Events.begin()->second;
+		_Events.erase(_Events.begin());
+		func();
+	}
+}
+
+unsigned long long Ec21Emulator::GetNextEventTime() const
+{
+	return _Events.size() >= 1 ? _Events.begin()->first : ~0ULL;
+}
+
+void Ec21Emulator::OnPinWrite(uint32_t pin, uint32_t value)
+{
+	switch (pin) {
+	case MODULE_PWR_PIN:
+		_Supply = value == HIGH;
+		if (!_Supply) PowerOff();
+		break;
+	case PWR_KEY_PIN:
+		if (value == HIGH) {
+			_PwrKeyHigh = true;
+			_PwrKeyTime = HostClock::Now();
+		}
+		else if (_PwrKeyHigh) {
+			_PwrKeyHigh = false;
+			if (_Supply && !_On && HostClock::Now() - _PwrKeyTime >= PWR_KEY_PULSE_MIN * 1000ULL) PowerOn();
+		}
+		break;
+	case RESET_MODULE_PIN:
+		if (value == LOW) {
+			_ResetFromOn = _On;
+			PowerOff();
+		}
+		else if (_ResetFromOn) {
+			_ResetFromOn = false;
+			if (_Supply) PowerOn();
+		}
+		break;
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////////////
+// HostSerialPeer
+
+void Ec21Emulator::OnSerialReceive(uint8_t data, unsigned long baud)
+{
+	if (!_On) return;
+	if (baud != _Baud) return;	// Framing errors.
+
+	switch (_Mode) {
+	case MODE_COMMAND:
+		if (_Echo) _Serial.Deliver(data, _Baud);
+		if (data == '\r') {
+			std::string line = _Input;
+			_Input.clear();
+			if (line.size() >= 1) ExecuteLine(line);
+		}
+		else if (data != '\n') {
+			_Input += (char)data;
+		}
+		break;
+	case MODE_DATA:
+		_Input += (char)data;
+		if ((int)_Input.size() >= _DataSize) {
+			std::string received = _Input;
+			_Input.clear();
+			_Mode = MODE_COMMAND;
+			_DataHandler(received);
+		}
+		break;
+	case MODE_SMS_TEXT:
+		if (data == 0x1a) {
+			std::string received = _Input;
+			_Input.clear();
+			_Mode = MODE_COMMAND;
+			_DataHandler(received);
+		}
+		else if (data == 0x1b) {
+			_Input.clear();
+			_Mode = MODE_COMMAND;
+			Finish("\r\nOK\r\n");
+		}
+		else {
+			_Input += (char)data;
+		}
+		break;
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////////////
+// Scripting
+
+void Ec21Emulator::Reply(const std::string& line, unsigned long delayMs)
+{
+	EmitAfter(_ResponseLatency + delayMs, line);
+}
+
+void Ec21Emulator::SetRegistration(int stat)
+{
+	_NetworkStat = stat;
+	if (_On) SetRegistrationStat(stat);
+}
+
+void Ec21Emulator::PushSocketData(int connectId, const std::string& data)
+{
+	Socket& socket = _Sockets[connectId];
+	if (!socket.Used || socket.State != 2) return;
+
+	bool notify = socket.Rx.size() <= 0;
+	socket.Rx += data;
+	socket.RxTotal += data.size();
+	if (notify) EmitLine("+QIURC: \"recv\"," + std::to_string(connectId));
+}
+
+void Ec21Emulator::CloseSocketByPeer(int connectId)
+{
+	Socket& socket = _Sockets[connectId];
+	if (!socket.Used || (socket.State != 1 && socket.State != 2)) return;
+
+	socket.State = 4;
+	EmitLine("+QIURC: \"closed\"," + std::to_string(connectId));
+}
+
+void Ec21Emulator::DeactivateContext()
+{
+	_ContextActive = false;
+	for (int i = 0; i < CONNECT_ID_NUM; i++) {
+		if (_Sockets[i].Used) _Sockets[i].State = 4;
+	}
+	EmitLine("+QIURC: \"pdpdeact\",1");
+}
+
+int Ec21Emulator::AddSms(const std::string& pdu, bool notify)
+{
+	int index = 0;
+	for (bool used = true; used; ) {
+		used = false;
+		for (size_t i = 0; i < _Sms.size(); i++) {
+			if (_Sms[i].Index == index) {
+				used = true;
+				index++;
+				break;
+			}
+		}
+	}
+	Sms sms = { index, pdu };
+	_Sms.push_back(sms);
+	if (_On && notify && _CnmiMt == 1) EmitLine("+CMTI: \"SM\"," + std::to_string(index));
+
+	return index;
+}
+
+int Ec21Emulator::CountCommands(const std::string& prefix) const
+{
+	int count = 0;
+	for (size_t i = 0; i < _Commands.size(); i++) {
+		if (_Commands[i].compare(0, prefix.size(), prefix) == 0) count++;
+	}
+
+	return count;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////
+// Internal
+
+void Ec21Emulator::Schedule(unsigned long delayMs, std::function<void()> func)
+{
+	_Events.insert(std::make_pair(HostClock::Now() + delayMs * 1000ULL, func));
+}
+
+void Ec21Emulator::Emit(const std::string& data)
+{
+	if (!_On) return;
+
+	for (size_t i = 0; i < data.size(); i++) _Serial.Deliver(data[i], _Baud);
+}
+
+void Ec21Emulator::EmitLine(const std::string& line)
+{
+	Emit("\r\n" + line + "\r\n");
+}
+
+void Ec21Emulator::EmitAfter(unsigned long delayMs, const std::string& line)
+{
+	Schedule(delayMs, [this, line]() { EmitLine(line); });
+}
+
+void Ec21Emulator::PowerOn()
+{
+	_On = true;
+	_Events.clear();
+	_Baud = _SavedBaud;
+	_Echo = true;
+	_Mode = MODE_COMMAND;
+	_Input.clear();
+	_CregN = 0;
+	_CgregN = 0;
+	_CeregN = 0;
+	_CnmiMt = 1;
+	_RegistrationStat = 2;
+	_ContextActive = false;
+	_GnssOn = false;
+	for (int i = 0; i < CONNECT_ID_NUM; i++) _Sockets[i].Used = false;
+
+	EmitAfter(_BootTime, "RDY");
+	if (_SimReady) EmitAfter(_BootTime + 100, "+CPIN: READY");
+	Schedule(_BootTime + _RegistrationTime, [this]() { SetRegistrationStat(_NetworkStat); });
+}
+
+void Ec21Emulator::PowerOff()
+{
+	_On = false;
+	_Events.clear();
+	_Mode = MODE_COMMAND;
+	_Input.clear();
+}
+
+void Ec21Emulator::SetRegistrationStat(int stat)
+{
+	if (stat == _RegistrationStat) return;
+
+	_RegistrationStat = stat;
+	if (_CregN >= 1) EmitLine("+CREG: " + std::to_string(stat));
+	if (_CgregN >= 1) EmitLine("+CGREG: " + std::to_string(stat));
+	if (_CeregN >= 1) EmitLine("+CEREG: " + std::to_string(stat));
+}
+
+void Ec21Emulator::ReceiveData(int dataSize, std::function<void(const std::string& data)> handler)
+{
+	_Input.clear();
+	_DataSize = dataSize;
+	_DataHandler = handler;
+	_Mode = MODE_DATA;
+	if (dataSize <= 0) {
+		_Mode = MODE_COMMAND;
+		handler("");
+	}
+}
+
+void Ec21Emulator::Finish(const std::string& out)
+{
+	Schedule(_ResponseLatency, [this, out]() { Emit(out); });
+}
+
+void Ec21Emulator::ExecuteLine(const std::string& line)
+{
+	_Commands.push_back(line);
+	if (_CommandHook && _CommandHook(line)) return;
+
+	if (line.size() < 2 || toupper(line[0]) != 'A' || toupper(line[1]) != 'T') {
+		Finish("\r\nERROR\r\n");
+		return;
+	}
+
+	// "AT+A;+B" runs each command in turn and stops at the first error.
+	std::vector<std::string> commands = SplitCommands(line.substr(2));
+	std::string out;
+	for (size_t i = 0; i < commands.size(); i++) {
+		switch (Execute(commands[i], &out)) {
+		case RESULT_OK:
+			break;
+		case RESULT_ERROR:
+			Finish(out);
+			return;
+		case RESULT_PENDING:
+			return;
+		}
+	}
+	AppendLine(&out, "OK");
+	Finish(out);
+}
+
+Ec21Emulator::ResultType Ec21Emulator::Execute(const std::string& command, std::string* out)
+{
+	if (command.size() <= 0) return RESULT_OK;
+	if (command == "E0" || command == "E1") {
+		_Echo = command == "E1";
+		return RESULT_OK;
+	}
+	if (command == "&W") {
+		_SavedBaud = _Baud;
+		return RESULT_OK;
+	}
+	if (command[0] != '+') {
+		AppendLine(out, "ERROR");
+		return RESULT_ERROR;
+	}
+
+	size_t pos = command.find_first_of("=?");
+	std::string name = command.substr(0, pos);
+	bool query = pos != std::string::npos && command[pos] == '?';
+	std::string args = pos != std::string::npos && command[pos] == '=' ? command.substr(pos + 1) : "";
+	if (args == "?") return RESULT_OK;	// Test command.
+	std::vector<std::string> argv = SplitArguments(args);
+
+	if (name == "+IPR") {
+		unsigned long baud = ArgumentAsInt(argv, 0, 0);
+		if (baud <= 0) {
+			AppendLine(out, "ERROR");
+			return RESULT_ERROR;
+		}
+		// OK still goes out at the old rate.
+		Schedule(_ResponseLatency, [this, baud]() {
+			EmitLine("OK");
+			_Baud = baud;
+		});
+		return RESULT_PENDING;
+	}
+	if (name == "+QURCCFG" || name == "+QSCLK" || name == "+QICSGP" || name == "+QLOCCFG" || name == "+QSSLCFG") return RESULT_OK;
+	if (name == "+CPIN") {
+		if (!_SimReady) {
+			AppendLine(out, "+CME ERROR: 10");
+			return RESULT_ERROR;
+		}
+		AppendLine(out, "+CPIN: READY");
+		return RESULT_OK;
+	}
+	if (name == "+CREG" || name == "+CGREG" || name == "+CEREG") {
+		int& n = name == "+CREG" ? _CregN : name == "+CGREG" ? _CgregN : _CeregN;
+		if (query) {
+			AppendLine(out, name + ": " + std::to_string(n) + "," + std::to_string(_RegistrationStat));
+		}
+		else {
+			n = ArgumentAsInt(argv, 0, 0);
+		}
+		return RESULT_OK;
+	}
+	if (name == "+CGMR") {
+		AppendLine(out, REVISION);
+		return RESULT_OK;
+	}
+	if (name == "+GSN") {
+		AppendLine(out, IMEI);
+		return RESULT_OK;
+	}
+	if (name == "+CIMI" || name == "+QCCID" || name == "+CNUM") {
+		if (!_SimReady) {
+			AppendLine(out, "+CME ERROR: 10");
+			return RESULT_ERROR;
+		}
+		if (name == "+CIMI") AppendLine(out, IMSI);
+		if (name == "+QCCID") AppendLine(out, "+QCCID: " ICCID);
+		if (name == "+CNUM") AppendLine(out, "+CNUM: ,\"" PHONE_NUMBER "\",129");
+		return RESULT_OK;
+	}
+	if (name == "+CSQ") {
+		AppendLine(out, "+CSQ: 20,99");
+		return RESULT_OK;
+	}
+	if (name == "+CCLK") {
+		AppendLine(out, "+CCLK: \"26/10/16,12:34:56+36\"");
+		return RESULT_OK;
+	}
+	if (name == "+QIACT") {
+		if (query) {
+			if (_ContextActive) AppendLine(out, "+QIACT: 1,1,1,\"10.0.0.1\"");
+			return RESULT_OK;
+		}
+		if (_RegistrationStat != 1 && _RegistrationStat != 5) {
+			AppendLine(out, "ERROR");
+			return RESULT_ERROR;
+		}
+		Schedule(_ResponseLatency + 500, [this]() {
+			_ContextActive = true;
+			EmitLine("OK");
+		});
+		return RESULT_PENDING;
+	}
+	if (name == "+QIDEACT") {
+		_ContextActive = false;
+		for (int i = 0; i < CONNECT_ID_NUM; i++) _Sockets[i].Used = false;
+		return RESULT_OK;
+	}
+	if (name == "+QIGETERROR") {
+		AppendLine(out, "+QIGETERROR: 0,operation successfully");
+		return RESULT_OK;
+	}
+	if (name == "+QNTP") {
+		AppendLine(out, "OK");
+		Finish(*out);
+		EmitAfter(_ResponseLatency + 1000, "+QNTP: 0,\"2026/10/16,12:34:56+36\"");
+		return RESULT_PENDING;
+	}
+	if (name == "+QCELLLOC") {
+		AppendLine(out, "+QCELLLOC: 139.700000,35.600000");
+		AppendLine(out, "OK");
+		std::string result = *out;
+		Schedule(_ResponseLatency + 1000, [this, result]() { Emit(result); });
+		return RESULT_PENDING;
+	}
+	if (name == "+QGPS" || name == "+QGPSEND" || name == "+QGPSLOC") {
+		if (name == "+QGPS") {
+			if (_GnssOn) {
+				AppendLine(out, "+CME ERROR: 504");
+				return RESULT_ERROR;
+			}
+			_GnssOn = true;
+			return RESULT_OK;
+		}
+		if (!_GnssOn) {
+			AppendLine(out, "+CME ERROR: 505");
+			return RESULT_ERROR;
+		}
+		if (name == "+QGPSEND") {
+			_GnssOn = false;
+			return RESULT_OK;
+		}
+		if (_GnssFix.size() <= 0) {
+			AppendLine(out, "+CME ERROR: 516");
+			return RESULT_ERROR;
+		}
+		AppendLine(out, "+QGPSLOC: " + _GnssFix);
+		return RESULT_OK;
+	}
+	if (name == "+QPOWD") {
+		AppendLine(out, "OK");
+		Finish(*out);
+		Schedule(_ResponseLatency + POWER_DOWN_TIME, [this]() {
+			EmitLine("POWERED DOWN");
+			PowerOff();
+		});
+		return RESULT_PENDING;
+	}
+	if (name.compare(0, 3, "+QI") == 0) return ExecuteSocket(name, args, out);
+	if (name.compare(0, 6, "+QHTTP") == 0) return ExecuteHttp(name, args, out);
+	if (name.compare(0, 3, "+CM") == 0 || name == "+CNMI") return ExecuteSms(name, args, out);
+
+	AppendLine(out, "ERROR");
+	return RESULT_ERROR;
+}
+
+Ec21Emulator::ResultType Ec21Emulator::ExecuteSocket(const std::string& name, const std::string& args, std::string* out)
+{
+	std::vector<std::string> argv = SplitArguments(args);
+
+	if (name == "+QISTATE") {
+		for (int i = 0; i < CONNECT_ID_NUM; i++) {
+			const Socket& socket = _Sockets[i];
+			if (!socket.Used) continue;
+			AppendLine(out, "+QISTATE: " + std::to_string(i) + ",\"" + socket.Type + "\",\"" + socket.Host + "\"," + std::to_string(socket.Port) + ",0," + std::to_string(socket.State) + ",1,0,0,\"uart1\"");
+		}
+		return RESULT_OK;
+	}
+
+	int connectId = name == "+QIOPEN" ? ArgumentAsInt(argv, 1, -1) : ArgumentAsInt(argv, 0, -1);
+	if (connectId < 0 || CONNECT_ID_NUM <= connectId) {
+		AppendLine(out, "ERROR");
+		return RESULT_ERROR;
+	}
+	Socket& socket = _Sockets[connectId];
+
+	if (name == "+QIOPEN") {
+		if (socket.Used) {
+			AppendLine(out, "+CME ERROR: 563");	// Socket identity has been used.
+			return RESULT_ERROR;
+		}
+		socket.Used = true;
+		socket.State = 1;
+		socket.Type = argv.size() >= 3 ? argv[2] : "";
+		socket.Host = argv.size() >= 4 ? argv[3] : "";
+		socket.Port = ArgumentAsInt(argv, 4, 0);
+		socket.Rx.clear();
+		socket.RxTotal = 0;
+		socket.RxRead = 0;
+		socket.Tx.clear();
+		socket.Acked = 0;
+
+		int err = _ContextActive ? _OpenResult : 561;	// Open PDP context failed.
+		_OpenResult = 0;
+		if (err >= 0) {
+			Schedule(_ResponseLatency + _OpenLatency, [this, connectId, err]() {
+				Socket& socket = _Sockets[connectId];
+				if (!socket.Used || socket.State != 1) return;
+				if (err == 0) socket.State = 2;
+				EmitLine("+QIOPEN: " + std::to_string(connectId) + "," + std::to_string(err));
+			});
+		}
+		return RESULT_OK;
+	}
+	if (name == "+QICLOSE") {
+		socket.Used = false;
+		return RESULT_OK;
+	}
+
+	if (!socket.Used) {
+		AppendLine(out, "ERROR");
+		return RESULT_ERROR;
+	}
+
+	if (name == "+QISEND") {
+		if (socket.State != 2) {
+			AppendLine(out, "SEND FAIL");
+			return RESULT_ERROR;
+		}
+		int length = ArgumentAsInt(argv, 1, -1);
+		if (length == 0) {
+			int acked = socket.Type == "UDP" ? socket.Tx.size() : socket.Acked;
+			AppendLine(out, "+QISEND: " + std::to_string(socket.Tx.size()) + "," + std::to_string(acked) + "," + std::to_string(socket.Tx.size() - acked));
+			return RESULT_OK;
+		}
+		if (length < 0 || SEND_SIZE_MAX < length) {
+			AppendLine(out, "ERROR");
+			return RESULT_ERROR;
+		}
+		Schedule(_ResponseLatency, [this]() { Emit("> "); });
+		ReceiveData(length, [this, connectId](const std::string& data) {
+			_Sockets[connectId].Tx += data;
+			EmitAfter(_SendLatency, "SEND OK");
+			int size = data.size();
+			Schedule(_AckDelay, [this, connectId, size]() { _Sockets[connectId].Acked += size; });
+		});
+		return RESULT_PENDING;
+	}
+	if (name == "+QIRD") {
+		int length = ArgumentAsInt(argv, 1, READ_SIZE_MAX);
+		if (length == 0) {
+			AppendLine(out, "+QIRD: " + std::to_string(socket.RxTotal) + "," + std::to_string(socket.RxRead) + "," + std::to_string(socket.Rx.size()));
+			return RESULT_OK;
+		}
+		if (length > (int)socket.Rx.size()) length = socket.Rx.size();
+		AppendLine(out, "+QIRD: " + std::to_string(length));
+		if (length >= 1) {
+			*out += socket.Rx.substr(0, length) + "\r\n";
+			socket.Rx.erase(0, length);
+			socket.RxRead += length;
+		}
+		return RESULT_OK;
+	}
+
+	AppendLine(out, "ERROR");
+	return RESULT_ERROR;
+}
+
+Ec21Emulator::ResultType Ec21Emulator::ExecuteHttp(const std::string& name, const std::string& args, std::string* out)
+{
+	std::vector<std::string> argv = SplitArguments(args);
+
+	if (name == "+QHTTPCFG") return RESULT_OK;
+	if (name == "+QHTTPURL") {
+		Schedule(_ResponseLatency, [this]() { EmitLine("CONNECT"); });
+		ReceiveData(ArgumentAsInt(argv, 0, 0), [this](const std::string& data) {
+			_HttpUrl = data;
+			Finish("\r\nOK\r\n");
+		});
+		return RESULT_PENDING;
+	}
+	if (name == "+QHTTPGET" || name == "+QHTTPPOST") {
+		bool get = name == "+QHTTPGET";
+		int length = get ? ArgumentAsInt(argv, 1, 0) : ArgumentAsInt(argv, 0, 0);
+		Schedule(_ResponseLatency, [this]() { EmitLine("CONNECT"); });
+		ReceiveData(length, [this, get](const std::string& data) {
+			_HttpRequest = data;
+			Finish("\r\nOK\r\n");
+			std::string result = get ? "+QHTTPGET: 0," + std::to_string(_HttpStatus) + "," + std::to_string(_HttpBody.size()) : "+QHTTPPOST: 0," + std::to_string(_HttpStatus);
+			EmitAfter(_ResponseLatency + _HttpLatency, result);
+		});
+		return RESULT_PENDING;
+	}
+	if (name == "+QHTTPREAD") {
+		std::string result = "\r\nCONNECT\r\n" + _HttpBody + "\r\nOK\r\n\r\n+QHTTPREAD: 0\r\n";
+		Schedule(_ResponseLatency, [this, result]() { Emit(result); });
+		return RESULT_PENDING;
+	}
+
+	AppendLine(out, "ERROR");
+	return RESULT_ERROR;
+}
+
+Ec21Emulator::ResultType Ec21Emulator::ExecuteSms(const std::string& name, const std::string& args, std::string* out)
+{
+	std::vector<std::string> argv = SplitArguments(args);
+
+	if (name == "+CMGF") {
+		_SmsFormat = ArgumentAsInt(argv, 0, 0);
+		return RESULT_OK;
+	}
+	if (name == "+CNMI") {
+		_CnmiMt = ArgumentAsInt(argv, 1, 0);
+		return RESULT_OK;
+	}
+	if (name == "+CMGL") {
+		for (size_t i = 0; i < _Sms.size(); i++) {
+			AppendLine(out, "+CMGL: " + std::to_string(_Sms[i].Index) + ",1,," + std::to_string(_Sms[i].Pdu.size() / 2));
+			*out += _Sms[i].Pdu + "\r\n";
+		}
+		return RESULT_OK;
+	}
+	if (name == "+CMGR" || name == "+CMGD") {
+		int index = ArgumentAsInt(argv, 0, -1);
+		for (size_t i = 0; i < _Sms.size(); i++) {
+			if (_Sms[i].Index != index) continue;
+			if (name == "+CMGD") {
+				_Sms.erase(_Sms.begin() + i);
+			}
+			else {
+				AppendLine(out, "+CMGR: 1,," + std::to_string(_Sms[i].Pdu.size() / 2));
+				*out += _Sms[i].Pdu + "\r\n";
+			}
+			return RESULT_OK;
+		}
+		if (name == "+CMGD") return RESULT_OK;
+		AppendLine(out, "+CMS ERROR: 321");	// Invalid memory index.
+		return RESULT_ERROR;
+	}
+	if (name == "+CMGS") {
+		if (_SmsFormat != 1) {
+			AppendLine(out, "+CMS ERROR: 304");
+			return RESULT_ERROR;
+		}
+		Schedule(_ResponseLatency, [this]() { Emit("\r\n> "); });
+		_Input.clear();
+		_Mode = MODE_SMS_TEXT;
+		_DataHandler = [this](const std::string& text) {
+			_SentSms.push_back(text);
+			std::string result = "\r\n+CMGS: " + std::to_string(_SentSms.size()) + "\r\n\r\nOK\r\n";
+			Schedule(_SendLatency, [this, result]() { Emit(result); });
+		};
+		return RESULT_PENDING;
+	}
+
+	AppendLine(out, "ERROR");
+	return RESULT_ERROR;
+}
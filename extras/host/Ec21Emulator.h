@@ -0,0 +1,168 @@
+#pragma once
+
+#include <Arduino.h>
+#include <string>
+#include <vector>
+#include <map>
+#include <functional>
+
+// Scriptable model of a Quectel EC21 on the module UART.
+// It answers the AT commands the library issues, with their latencies in virtual time, and lets a test inject URCs and peer traffic.
+class Ec21Emulator : public HostDevice, public HostSerialPeer
+{
+public:
+	static const int CONNECT_ID_NUM = 12;
+
+	static const int MODULE_PWR_PIN = 21;
+	static const int PWR_KEY_PIN = 36;
+	static const int RESET_MODULE_PIN = 35;
+
+	// A hook returns true when it has answered the command itself (see Reply()).
+	typedef std::function<bool(const std::string& command)> CommandHook;
+
+private:
+	enum InputMode {
+		MODE_COMMAND,
+		MODE_DATA,		// A fixed number of bytes after CONNECT or "> ".
+		MODE_SMS_TEXT,	// Text up to Ctrl-Z.
+	};
+
+	enum ResultType {
+		RESULT_OK,
+		RESULT_ERROR,
+		RESULT_PENDING,	// The command answers on its own, e.g. after a prompt.
+	};
+
+	struct Socket {
+		bool Used;
+		int State;		// +QISTATE <socket_state>.
+		std::string Type;
+		std::string Host;
+		int Port;
+		std::string Rx;
+		int RxTotal;
+		int RxRead;
+		std::string Tx;
+		int Acked;
+	};
+
+	struct Sms {
+		int Index;
+		std::string Pdu;
+	};
+
+	HardwareSerial& _Serial;
+	std::multimap<unsigned long long, std::function<void()> > _Events;
+
+	bool _Supply;
+	bool _On;
+	bool _PwrKeyHigh;
+	unsigned long long _PwrKeyTime;
+	bool _ResetFromOn;
+
+	unsigned long _Baud;
+	unsigned long _SavedBaud;
+	bool _Echo;
+
+	InputMode _Mode;
+	std::string _Input;
+	int _DataSize;
+	std::function<void(const std::string& data)> _DataHandler;
+
+	int _CregN;
+	int _CgregN;
+	int _CeregN;
+	int _RegistrationStat;
+	int _NetworkStat;		// What the module registers as once it has booted.
+	bool _SimReady;
+	bool _ContextActive;
+	bool _GnssOn;
+	std::string _GnssFix;
+	int _SmsFormat;
+	int _CnmiMt;		// +CNMI <mt>, 1 for +CMTI.
+	std::vector<Sms> _Sms;
+	std::vector<std::string> _SentSms;
+	Socket _Sockets[CONNECT_ID_NUM];
+	int _OpenResult;
+	std::string _HttpUrl;
+	std::string _HttpRequest;
+	int _HttpStatus;
+	std::string _HttpBody;
+
+	unsigned long _BootTime;
+	unsigned long _RegistrationTime;
+	unsigned long _ResponseLatency;
+	unsigned long _OpenLatency;
+	unsigned long _SendLatency;
+	unsigned long _AckDelay;
+	unsigned long _HttpLatency;
+
+	CommandHook _CommandHook;
+	std::vector<std::string> _Commands;
+
+	void Emit(const std::string& data);
+	void EmitLine(const std::string& line);
+	void EmitAfter(unsigned long delayMs, const std::string& line);
+
+	void PowerOn();
+	void PowerOff();
+	void SetRegistrationStat(int stat);
+
+	void ExecuteLine(const std::string& line);
+	ResultType Execute(const std::string& command, std::string* out);
+	ResultType ExecuteSocket(const std::string& name, const std::string& args, std::string* out);
+	ResultType ExecuteHttp(const std::string& name, const std::string& args, std::string* out);
+	ResultType ExecuteSms(const std::string& name, const std::string& args, std::string* out);
+	void ReceiveData(int dataSize, std::function<void(const std::string& data)> handler);
+	void Finish(const std::string& out);
+
+public:
+	Ec21Emulator(HardwareSerial& serial);
+	virtual ~Ec21Emulator();
+
+	// HostDevice
+	virtual void Process(unsigned long long nowMicros);
+	virtual unsigned long long GetNextEventTime() const;
+	virtual void OnPinWrite(uint32_t pin, uint32_t value);
+
+	// HostSerialPeer
+	virtual void OnSerialReceive(uint8_t data, unsigned long baud);
+
+	// Timing, in milliseconds.
+	void SetBootTime(unsigned long time) { _BootTime = time; }
+	void SetRegistrationTime(unsigned long time) { _RegistrationTime = time; }
+	void SetResponseLatency(unsigned long time) { _ResponseLatency = time; }
+	void SetOpenLatency(unsigned long time) { _OpenLatency = time; }
+	void SetSendLatency(unsigned long time) { _SendLatency = time; }
+	void SetAckDelay(unsigned long time) { _AckDelay = time; }
+	void SetHttpLatency(unsigned long time) { _HttpLatency = time; }
+
+	// Scripting.
+	void SetCommandHook(CommandHook hook) { _CommandHook = hook; }
+	void Schedule(unsigned long delayMs, std::function<void()> func);	// Runs func that much later in virtual time.
+	void Reply(const std::string& line, unsigned long delayMs = 0);
+	void SendUrc(const std::string& line) { EmitLine(line); }
+	void SetSimReady(bool ready) { _SimReady = ready; }
+	void SetRegistration(int stat);
+	void SetOpenResult(int err) { _OpenResult = err; }		// <err> of the next +QIOPEN.
+	void PushSocketData(int connectId, const std::string& data);
+	void CloseSocketByPeer(int connectId);
+	void DeactivateContext();
+	void SetHttpResponse(int status, const std::string& body) { _HttpStatus = status; _HttpBody = body; }
+	int AddSms(const std::string& pdu, bool notify = true);		// notify false loses the +CMTI.
+	void SetGnssFix(const std::string& fix) { _GnssFix = fix; }
+
+	// Inspection.
+	bool IsOn() const { return _On; }
+	unsigned long GetBaud() const { return _Baud; }
+	const std::vector<std::string>& GetCommands() const { return _Commands; }
+	int CountCommands(const std::string& prefix) const;
+	void ClearCommands() { _Commands.clear(); }
+	bool IsSocketUsed(int connectId) const { return _Sockets[connectId].Used; }
+	const std::string& GetSocketSentData(int connectId) const { return _Sockets[connectId].Tx; }
+	int GetSmsCount() const { return _Sms.size(); }
+	const std::vector<std::string>& GetSentSms() const { return _SentSms; }
+	const std::string& GetHttpUrl() const { return _HttpUrl; }
+	const std::string& GetHttpRequest() const { return _HttpRequest; }
+
+};
@@ -0,0 +1,104 @@
+#include "TranscriptPlayer.h"
+
+#define TRANSCRIPT_SEND		(0)
+#define TRANSCRIPT_RECEIVE	(1)
+
+static bool DecodeVarint(const std::vector<uint8_t>& data, size_t* offset, unsigned long* value)
+{
+	*value = 0;
+	for (int shift = 0; *offset < data.size() && shift < 35; shift += 7) {
+		uint8_t b = data[(*offset)++];
+		*value |= (unsigned long)(b & 0x7f) << shift;
+		if ((b & 0x80) == 0) return true;
+	}
+
+	return false;
+}
+
+TranscriptPlayer::TranscriptPlayer(HardwareSerial& serial, const std::vector<uint8_t>& transcript) :
+	_Serial(serial),
+	_Valid(false),
+	_Index(0),
+	_SentSize(0),
+	_LastTime(HostClock::Now()),
+	_MismatchNum(0)
+{
+	Parse(transcript);
+	_Serial.SetPeer(this);
+}
+
+TranscriptPlayer::~TranscriptPlayer()
+{
+	_Serial.SetPeer(NULL);
+}
+
+void TranscriptPlayer::Parse(const std::vector<uint8_t>& transcript)
+{
+	size_t offset = 0;
+	while (offset < transcript.size()) {
+		Record record;
+		uint8_t direction = transcript[offset++];
+		if (direction != TRANSCRIPT_SEND && direction != TRANSCRIPT_RECEIVE) return;
+		record.Receive = direction == TRANSCRIPT_RECEIVE;
+
+		unsigned long size;
+		if (!DecodeVarint(transcript, &offset, &size)) return;
+		if (!DecodeVarint(transcript, &offset, &record.Gap)) return;
+		if (size > transcript.size() - offset) return;
+		record.Data.assign((const char*)&transcript[offset], size);
+		offset += size;
+
+		_Records.push_back(record);
+	}
+
+	_Valid = true;
+}
+
+unsigned long long TranscriptPlayer::GetDeliverTime() const
+{
+	// The recorded time is when the library read the first byte, truncated to milliseconds.
+	// Starting a millisecond early has the byte waiting in the UART by then, as it was.
+	unsigned long long time = _LastTime + _Records[_Index].Gap * 1000ULL;
+	unsigned long long lead = 1000 + _Serial.GetByteTime();
+	return time - _LastTime > lead ? time - lead : _LastTime;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////
+// HostDevice
+
+void TranscriptPlayer::Process(unsigned long long nowMicros)
+{
+	while (!IsFinished() && _Records[_Index].Receive) {
+		unsigned long long time = GetDeliverTime();
+		if (time > nowMicros) break;
+
+		const std::string& data = _Records[_Index].Data;
+		for (size_t i = 0; i < data.size(); i++) _Serial.Deliver(data[i], _Serial.GetBaud());
+		_LastTime = _LastTime + _Records[_Index].Gap * 1000ULL;
+		_Index++;
+	}
+}
+
+unsigned long long TranscriptPlayer::GetNextEventTime() const
+{
+	return !IsFinished() && _Records[_Index].Receive ? GetDeliverTime() : ~0ULL;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////
+// HostSerialPeer
+
+void TranscriptPlayer::OnSerialReceive(uint8_t data, unsigned long /* baud */)
+{
+	if (IsFinished() || _Records[_Index].Receive) {
+		_MismatchNum++;
+		return;
+	}
+
+	const Record& record = _Records[_Index];
+	if (_SentSize == 0) _LastTime = HostClock::Now() - _Serial.GetByteTime();	// When the write began.
+	if ((uint8_t)record.Data[_SentSize] != data) _MismatchNum++;
+	if (++_SentSize >= record.Data.size()) {
+		_SentSize = 0;
+		_Index++;
+	}
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <Arduino.h>
+#include <string>
+#include <vector>
+
+// Plays a transcript recorded by WioLTE::SetTranscriptFunction() back as the module.
+// Received records are delivered at their recorded gap after the record before them, to the millisecond, and what the library sends is compared with the sent records.
+class TranscriptPlayer : public HostDevice, public HostSerialPeer
+{
+private:
+	struct Record {
+		bool Receive;
+		unsigned long Gap;		// [msec.] since the previous record.
+		std::string Data;
+	};
+
+	HardwareSerial& _Serial;
+	std::vector<Record> _Records;
+	bool _Valid;
+
+	size_t _Index;					// Next record to play.
+	size_t _SentSize;				// Bytes of the current sent record received so far.
+	unsigned long long _LastTime;	// [usec.] when the previous record was played.
+	int _MismatchNum;
+
+	void Parse(const std::vector<uint8_t>& transcript);
+	unsigned long long GetDeliverTime() const;
+
+public:
+	TranscriptPlayer(HardwareSerial& serial, const std::vector<uint8_t>& transcript);
+	virtual ~TranscriptPlayer();
+
+	// HostDevice
+	virtual void Process(unsigned long long nowMicros);
+	virtual unsigned long long GetNextEventTime() const;
+
+	// HostSerialPeer
+	virtual void OnSerialReceive(uint8_t data, unsigned long baud);
+
+	bool IsValid() const { return _Valid; }		// The transcript parsed to its end.
+	bool IsFinished() const { return _Index >= _Records.size(); }
+	int GetMismatchNum() const { return _MismatchNum; }	// Bytes the library sent out of the transcript.
+
+};
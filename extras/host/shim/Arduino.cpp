@@ -0,0 +1,232 @@
+#include <Arduino.h>
+#include <Wire.h>
+#include <vector>
+#include <map>
+#include <algorithm>
+
+#define IDLE_STEP_MICROS	(1000)
+
+////////////////////////////////////////////////////////////////////////////////////////
+// Devices and clock
+
+static unsigned long long NowMicros = 0;
+
+static std::vector<HostDevice*>& Devices()
+{
+	static std::vector<HostDevice*> devices;
+	return devices;
+}
+
+HostDevice::HostDevice()
+{
+	Devices().push_back(this);
+}
+
+HostDevice::~HostDevice()
+{
+	std::vector<HostDevice*>& devices = Devices();
+	for (std::vector<HostDevice*>::iterator it = devices.begin(); it != devices.end(); it++) {
+		if (*it == this) {
+			devices.erase(it);
+			break;
+		}
+	}
+}
+
+unsigned long long HostClock::Now()
+{
+	return NowMicros;
+}
+
+void HostClock::Advance(unsigned long long micros)
+{
+	HostScope scope;
+	unsigned long long target = NowMicros + micros;
+	while (true) {
+		std::vector<HostDevice*> devices = Devices();
+		for (size_t i = 0; i < devices.size(); i++) devices[i]->Process(NowMicros);
+		if (NowMicros >= target) break;
+
+		// Devices are processed at each of their events, so that their replies are timed exactly.
+		unsigned long long next = target;
+		for (size_t i = 0; i < devices.size(); i++) {
+			unsigned long long time = devices[i]->GetNextEventTime();
+			if (NowMicros < time && time < next) next = time;
+		}
+		NowMicros = next;
+	}
+}
+
+unsigned long millis()
+{
+	return (unsigned long)(NowMicros / 1000);
+}
+
+unsigned long micros()
+{
+	return (unsigned long)NowMicros;
+}
+
+void delay(unsigned long ms)
+{
+	HostClock::Advance((unsigned long long)ms * 1000);
+}
+
+void delayMicroseconds(unsigned int us)
+{
+	HostClock::Advance(us);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////
+// Pins
+
+static std::map<uint32_t, uint32_t>& Pins()
+{
+	static std::map<uint32_t, uint32_t> pins;
+	return pins;
+}
+
+void pinMode(uint32_t /* pin */, uint32_t /* mode */)
+{
+}
+
+void digitalWrite(uint32_t pin, uint32_t value)
+{
+	HostScope scope;
+	Pins()[pin] = value;
+
+	std::vector<HostDevice*> devices = Devices();
+	for (size_t i = 0; i < devices.size(); i++) devices[i]->OnPinWrite(pin, value);
+}
+
+int digitalRead(uint32_t pin)
+{
+	return Pins()[pin];
+}
+
+////////////////////////////////////////////////////////////////////////////////////////
+// Print
+
+size_t Print::write(const uint8_t* data, size_t size)
+{
+	for (size_t i = 0; i < size; i++) write(data[i]);
+	return size;
+}
+
+size_t Print::print(long value)
+{
+	char str[24];
+	snprintf(str, sizeof (str), "%ld", value);
+	return print(str);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////
+// HardwareSerial
+
+HardwareSerial::HardwareSerial(bool console) :
+	_Baud(0),
+	_Peer(NULL),
+	_RxLastTime(0),
+	_Console(console)
+{
+}
+
+void HardwareSerial::begin(unsigned long baud)
+{
+	_Baud = baud;
+	_Rx.clear();
+}
+
+void HardwareSerial::end()
+{
+	_Baud = 0;
+}
+
+int HardwareSerial::available()
+{
+	HostClock::Advance(0);
+
+	// Arrival times are in order.
+	unsigned long long now = HostClock::Now();
+	int count = std::upper_bound(_Rx.begin(), _Rx.end(), now, [](unsigned long long time, const RxByte& rx) { return time < rx.Time; }) - _Rx.begin();
+	if (count >= 1) return count;
+
+	// Polling an empty UART is how the library waits, so time passes.
+	unsigned long long step = IDLE_STEP_MICROS;
+	if (_Rx.size() >= 1 && _Rx[0].Time - HostClock::Now() < step) step = _Rx[0].Time - HostClock::Now();
+	HostClock::Advance(step);
+
+	return 0;
+}
+
+int HardwareSerial::read()
+{
+	if (_Rx.size() <= 0 || _Rx[0].Time > HostClock::Now()) return -1;
+
+	uint8_t data = _Rx[0].Data;
+	_Rx.pop_front();
+	return data;
+}
+
+int HardwareSerial::peek()
+{
+	if (_Rx.size() <= 0 || _Rx[0].Time > HostClock::Now()) return -1;
+
+	return _Rx[0].Data;
+}
+
+size_t HardwareSerial::write(uint8_t data)
+{
+	if (_Console) {
+		putchar(data);
+		return 1;
+	}
+
+	HostScope scope;
+	HostClock::Advance(GetByteTime());
+	if (_Peer != NULL) _Peer->OnSerialReceive(data, _Baud);
+
+	return 1;
+}
+
+void HardwareSerial::flush()
+{
+	if (_Console) fflush(stdout);
+}
+
+unsigned long HardwareSerial::GetBaud() const
+{
+	return _Baud;
+}
+
+void HardwareSerial::SetPeer(HostSerialPeer* peer)
+{
+	_Peer = peer;
+}
+
+void HardwareSerial::Deliver(uint8_t data, unsigned long baud)
+{
+	if (baud != _Baud) return;	// Framing errors; nothing usable arrives.
+
+	unsigned long long time = _RxLastTime > HostClock::Now() ? _RxLastTime : HostClock::Now();
+	time += GetByteTime();
+	_Rx.push_back(RxByte{ data, time });
+	_RxLastTime = time;
+}
+
+unsigned long long HardwareSerial::GetByteTime() const
+{
+	if (_Baud <= 0) return 0;
+	return 10ULL * 1000000 / _Baud;	// Start, 8 data and stop bits.
+}
+
+////////////////////////////////////////////////////////////////////////////////////////
+// Instances
+
+HardwareSerial Serial(true);
+HardwareSerial SerialUSB(true);
+TwoWire Wire;
+
+// The module UART that WioLTEHardware.h declares for host builds.
+static HardwareSerial ModuleSerial;
+HardwareSerial& SerialModule = ModuleSerial;
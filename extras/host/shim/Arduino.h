@@ -0,0 +1,162 @@
+#pragma once
+
+// Minimal Arduino core for building the library on a Linux host.
+// Time is virtual: it only advances while the library waits, so runs are fast and repeatable.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <math.h>
+#include <string>
+#include <deque>
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+#define HIGH			(1)
+#define LOW				(0)
+
+#define INPUT			(0)
+#define OUTPUT			(1)
+#define INPUT_PULLUP	(2)
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+
+void pinMode(uint32_t pin, uint32_t mode);
+void digitalWrite(uint32_t pin, uint32_t value);
+int digitalRead(uint32_t pin);
+
+// Something that reacts to time passing or to pin changes, e.g. the modem emulator.
+class HostDevice
+{
+public:
+	HostDevice();
+	virtual ~HostDevice();
+	virtual void Process(unsigned long long /* nowMicros */) {}
+	virtual unsigned long long GetNextEventTime() const { return ~0ULL; }
+	virtual void OnPinWrite(uint32_t /* pin */, uint32_t /* value */) {}
+
+};
+
+class HostClock
+{
+public:
+	static unsigned long long Now();				// Microseconds.
+	static void Advance(unsigned long long micros);	// Lets every HostDevice run up to the new time.
+
+};
+
+// Counts the heap allocations of the library. Those made on the host side (the clock, the devices and the UART model) are left out.
+class HostAllocation
+{
+public:
+	static void Start();
+	static unsigned long Stop();	// Allocations since Start().
+
+};
+
+// Marks code that runs on behalf of the host while it is in scope.
+class HostScope
+{
+public:
+	HostScope();
+	~HostScope();
+
+};
+
+class String
+{
+private:
+	std::string _Str;
+
+public:
+	String() {}
+	String(const char* str) : _Str(str) {}
+	String(const String& str) : _Str(str._Str) {}
+	explicit String(int value) : _Str(std::to_string(value)) {}
+
+	const char* c_str() const { return _Str.c_str(); }
+	unsigned int length() const { return _Str.size(); }
+	String& operator=(const char* str) { _Str = str; return *this; }
+	String& operator=(const String& str) { _Str = str._Str; return *this; }
+	String& operator+=(const char* str) { _Str += str; return *this; }
+	String& operator+=(const String& str) { _Str += str._Str; return *this; }
+	bool operator==(const String& str) const { return _Str == str._Str; }
+	bool operator<(const String& str) const { return _Str < str._Str; }
+
+};
+
+class Print
+{
+public:
+	virtual ~Print() {}
+	virtual size_t write(uint8_t data) = 0;
+	virtual size_t write(const uint8_t* data, size_t size);
+	size_t print(char c) { return write((uint8_t)c); }
+	size_t print(const char* str) { return write((const uint8_t*)str, strlen(str)); }
+	size_t print(long value);
+	size_t println(const char* str) { return print(str) + print("\r\n"); }
+	size_t println() { return print("\r\n"); }
+
+};
+
+class Stream : public Print
+{
+public:
+	virtual int available() = 0;
+	virtual int read() = 0;
+	virtual int peek() = 0;
+	virtual void flush() {}
+
+};
+
+// Receives what the MCU writes to a HardwareSerial.
+class HostSerialPeer
+{
+public:
+	virtual ~HostSerialPeer() {}
+	virtual void OnSerialReceive(uint8_t data, unsigned long baud) = 0;
+
+};
+
+// UART model. Writes take the time of the line rate, received bytes become readable at their arrival time.
+class HardwareSerial : public Stream
+{
+private:
+	struct RxByte {
+		uint8_t Data;
+		unsigned long long Time;
+	};
+
+	unsigned long _Baud;
+	HostSerialPeer* _Peer;
+	std::deque<RxByte> _Rx;
+	unsigned long long _RxLastTime;
+	bool _Console;
+
+public:
+	HardwareSerial(bool console = false);
+
+	void begin(unsigned long baud);
+	void end();
+	int available();
+	int read();
+	int peek();
+	size_t write(uint8_t data);
+	using Print::write;
+	void flush();
+
+	unsigned long GetBaud() const;
+	void SetPeer(HostSerialPeer* peer);
+	void Deliver(uint8_t data, unsigned long baud);		// From the peer, after the bytes already in flight.
+	unsigned long long GetByteTime() const;				// Microseconds per byte at the current rate.
+
+};
+
+extern HardwareSerial Serial;
+extern HardwareSerial SerialUSB;
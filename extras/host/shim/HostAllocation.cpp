@@ -0,0 +1,64 @@
+#include <Arduino.h>
+#include <new>
+
+// Kept apart from the rest of the shim, whose containers would otherwise be inlined against these operators.
+
+static bool AllocationCounting = false;
+static unsigned long AllocationNum = 0;
+static int HostDepth = 0;
+
+HostScope::HostScope()
+{
+	HostDepth++;
+}
+
+HostScope::~HostScope()
+{
+	HostDepth--;
+}
+
+void HostAllocation::Start()
+{
+	AllocationNum = 0;
+	AllocationCounting = true;
+}
+
+unsigned long HostAllocation::Stop()
+{
+	AllocationCounting = false;
+	return AllocationNum;
+}
+
+void* operator new(size_t size)
+{
+	if (AllocationCounting && HostDepth <= 0) AllocationNum++;
+
+	void* ptr = malloc(size > 0 ? size : 1);
+	if (ptr == NULL) throw std::bad_alloc();
+	return ptr;
+}
+
+void* operator new[](size_t size)
+{
+	return operator new(size);
+}
+
+void operator delete(void* ptr) noexcept
+{
+	free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept
+{
+	free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept
+{
+	free(ptr);
+}
+
+void operator delete[](void* ptr, size_t) noexcept
+{
+	free(ptr);
+}
@@ -0,0 +1,9 @@
+#pragma once
+
+#include <Arduino.h>
+
+class TwoWire
+{
+};
+
+extern TwoWire Wire;
@@ -0,0 +1,40 @@
+#include "Test.h"
+
+static int FailureNum = 0;
+static int TestNum = 0;
+static int FailedTestNum = 0;
+
+void TestFail(const char* file, int line, const char* expr)
+{
+	printf("%s:%d: CHECK(%s) failed\n", file, line, expr);
+	FailureNum++;
+}
+
+int TestRun(const char* name, void (*func)())
+{
+	int failureNum = FailureNum;
+	unsigned long start = millis();
+	func();
+	TestNum++;
+	if (FailureNum != failureNum) FailedTestNum++;
+	printf("%-4s %s (%lu[msec.] virtual)\n", FailureNum == failureNum ? "OK" : "FAIL", name, millis() - start);
+
+	return FailureNum - failureNum;
+}
+
+int TestResult()
+{
+	printf("%d tests, %d failed\n", TestNum, FailedTestNum);
+
+	return FailedTestNum == 0 ? 0 : 1;
+}
+
+bool TestStart(WioLTE& wio, bool activate)
+{
+	wio.Init();
+	wio.PowerSupplyLTE(true);
+	if (!wio.TurnOnOrReset()) return false;
+	if (activate && !wio.Activate(APN, "", "")) return false;
+
+	return true;
+}
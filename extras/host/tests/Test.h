@@ -0,0 +1,15 @@
+#pragma once
+
+#include <WioLTEforArduino.h>
+#include "../Ec21Emulator.h"
+
+#define CHECK(expr)	do { if (!(expr)) TestFail(__FILE__, __LINE__, #expr); } while (0)
+
+#define APN		"apn.example"
+
+void TestFail(const char* file, int line, const char* expr);
+int TestRun(const char* name, void (*func)());
+int TestResult();
+
+// Powers on the emulated module and brings the library to where a sketch's setup() leaves it.
+bool TestStart(WioLTE& wio, bool activate = true);
@@ -0,0 +1,82 @@
+#include "Test.h"
+#include <Internal/AtFields.h>
+#include <string.h>
+
+// Matches line with pattern both directly and through slre, and checks that they agree.
+static bool MatchBoth(const AtPattern& pattern, const char* line, int captureNum)
+{
+	slre_cap captures[16];
+	slre_cap slreCaptures[16];
+	memset(captures, 0, sizeof (captures));
+	memset(slreCaptures, 0, sizeof (slreCaptures));
+
+	int length = strlen(line);
+	bool matched = pattern.Match(line, length, captures, captureNum);
+	bool slreMatched = slre_match(pattern.GetString(), line, length, slreCaptures, captureNum, 0) >= 1;
+	CHECK(matched == slreMatched);
+	if (!matched || !slreMatched) return matched;
+
+	for (int i = 0; i < captureNum; i++) {
+		// slre leaves an empty capture unset.
+		if (slreCaptures[i].len <= 0) continue;
+		CHECK(captures[i].ptr == slreCaptures[i].ptr && captures[i].len == slreCaptures[i].len);
+	}
+
+	return true;
+}
+
+static void TestFields()
+{
+	AtFields<int, int> creg("+CREG: ");
+	AtFields<double, double> loc("+QCELLLOC: ");
+	AtFields<AtString, int, AtString> mixed("+X: ");
+
+	CHECK(creg.GetPattern().IsCompiled());
+	CHECK(loc.GetPattern().IsCompiled());
+	CHECK(mixed.GetPattern().IsCompiled());
+
+	CHECK(MatchBoth(creg.GetPattern(), "+CREG: 0,1", creg.CAPTURE_NUM));
+	CHECK(MatchBoth(creg.GetPattern(), "+CREG: 2,5,\"1A2B\",\"0123ABCD\",7", creg.CAPTURE_NUM));
+	CHECK(MatchBoth(creg.GetPattern(), "+CREG: -1,-20", creg.CAPTURE_NUM));
+	CHECK(!MatchBoth(creg.GetPattern(), "+CREG: 1", creg.CAPTURE_NUM));
+	CHECK(!MatchBoth(creg.GetPattern(), "+CREG: 1,", creg.CAPTURE_NUM));
+	CHECK(!MatchBoth(creg.GetPattern(), "+CREG: 1,2x", creg.CAPTURE_NUM));
+	CHECK(!MatchBoth(creg.GetPattern(), "+CREG: -,2", creg.CAPTURE_NUM));
+	CHECK(!MatchBoth(creg.GetPattern(), "+CREG: 1.5,2", creg.CAPTURE_NUM));
+	CHECK(!MatchBoth(creg.GetPattern(), "+CGREG: 0,1", creg.CAPTURE_NUM));
+	CHECK(!MatchBoth(creg.GetPattern(), "", creg.CAPTURE_NUM));
+
+	CHECK(MatchBoth(loc.GetPattern(), "+QCELLLOC: 139.691700,35.689500", loc.CAPTURE_NUM));
+	CHECK(MatchBoth(loc.GetPattern(), "+QCELLLOC: -0.5,12", loc.CAPTURE_NUM));
+	CHECK(!MatchBoth(loc.GetPattern(), "+QCELLLOC: 1e3,2", loc.CAPTURE_NUM));
+
+	CHECK(MatchBoth(mixed.GetPattern(), "+X: \"a,b\",1,c", mixed.CAPTURE_NUM));
+	CHECK(MatchBoth(mixed.GetPattern(), "+X: abc,1,\"\"", mixed.CAPTURE_NUM));
+	CHECK(MatchBoth(mixed.GetPattern(), "+X: ,1,", mixed.CAPTURE_NUM));
+	CHECK(!MatchBoth(mixed.GetPattern(), "+X: \"a\"b,1,c,d", mixed.CAPTURE_NUM));
+	CHECK(MatchBoth(mixed.GetPattern(), "+X: \"a,1,b\"c", mixed.CAPTURE_NUM));
+	CHECK(MatchBoth(mixed.GetPattern(), "+X: \"open,1,c", mixed.CAPTURE_NUM));
+	CHECK(!MatchBoth(mixed.GetPattern(), "+X: a,b,c", mixed.CAPTURE_NUM));
+	CHECK(!MatchBoth(mixed.GetPattern(), "+X: a,1", mixed.CAPTURE_NUM));
+
+	// Captures, and NULL fields.
+	slre_cap captures[AtFields<AtString, int, AtString>::CAPTURE_NUM];
+	const char* line = "+X: \"a,b\",-7,plain,rest";
+	CHECK(mixed.GetPattern().Match(line, strlen(line), captures, mixed.CAPTURE_NUM));
+	AtString first;
+	AtString third;
+	int second;
+	mixed.Decode(captures, &first, &second, &third);
+	CHECK(first.Length == 3 && strncmp(first.Ptr, "a,b", 3) == 0);
+	CHECK(second == -7);
+	CHECK(third.Length == 5 && strncmp(third.Ptr, "plain", 5) == 0);
+	mixed.Decode(captures, NULL, &second, NULL);
+	CHECK(second == -7);
+}
+
+int main()
+{
+	TestRun("Fields", TestFields);
+
+	return TestResult();
+}
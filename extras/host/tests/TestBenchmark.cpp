@@ -0,0 +1,647 @@
+#include "Test.h"
+#include <Internal/AtSerial.h>
+#include <Internal/ArgumentParser.h>
+#include <Internal/StringBuilder.h>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <string.h>
+#include <stdarg.h>
+#include <stdio.h>
+
+// Host CPU time, unlike millis(). The best of several trials is taken to keep other processes out.
+#define TRIAL_NUM	(5)
+
+static double NowNanos()
+{
+	return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static void Deliver(HardwareSerial& serial, const std::string& data)
+{
+	for (size_t i = 0; i < data.size(); i++) serial.Deliver(data[i], serial.GetBaud());
+}
+
+////////////////////////////////////////////////////////////////////////////////////////
+// Framer
+
+// Lines taken from module transcripts, which arrive while the library waits for the "> " of AT+QISEND.
+static std::string BuildWaitingCorpus()
+{
+	std::string lines[] = {
+		"+QIURC: \"recv\",0",
+		"+CMTI: \"ME\",3",
+		"+QGPSLOC: 021410.0,3536.0000N,13942.0000E,1.0,40.5,3,0.00,0.0,0.0,161026,08",
+		"+CMGL: 0,1,,160",
+		std::string(320, 'A'),		// SMS PDU
+		std::string(1000, 'x'),		// Longest line
+	};
+
+	std::string corpus;
+	for (size_t i = 0; i < sizeof (lines) / sizeof (lines[0]); i++) corpus += "\r\n" + lines[i] + "\r\n";
+
+	return corpus;
+}
+
+// The framing before the streaming framer: the line grows byte by byte, and a pattern without end anchor is rescanned with slre after each byte.
+static bool LegacyReadLine(SerialAPI& serial, const char* pattern, std::string* response)
+{
+	response->clear();
+
+	Stopwatch sw;
+	while (true) {
+		if (response->size() >= (size_t)(AtSerial::RESPONSE_MAX_LENGTH + 2)) return false;
+
+		sw.Restart();
+		while (!serial.Available()) {
+			if (sw.ElapsedMilliseconds() >= 10) return false;
+		}
+		response->push_back(serial.Read());
+
+		if (response->size() >= 2 && response->at(response->size() - 2) == '\r' && response->at(response->size() - 1) == '\n') {
+			response->resize(response->size() - 2);
+			return true;
+		}
+		if (pattern != NULL && slre_match(pattern, response->c_str(), response->size(), NULL, 0, 0) >= 1) return true;
+	}
+}
+
+static bool LegacyReadResponse(SerialAPI& serial, WioLTE& wio, const char* pattern)
+{
+	const char* internalPattern = pattern[strlen(pattern) - 1] != '$' ? pattern : NULL;
+	while (true) {
+		std::string response;
+		if (!LegacyReadLine(serial, internalPattern, &response)) return false;
+		if (wio.ReadResponseCallback(response.c_str())) continue;
+		if (slre_match(pattern, response.c_str(), response.size(), NULL, 0, 0) >= 1) return true;
+	}
+}
+
+// Only takes the bytes out of the UART model, for its share in the times above.
+static void Drain(SerialAPI& serial, int size)
+{
+	Stopwatch sw;
+	for (int i = 0; i < size; i++) {
+		sw.Restart();
+		while (!serial.Available());
+		serial.Read();
+	}
+}
+
+static void TestFramer()
+{
+	HardwareSerial serial;
+	SerialAPI serialApi(&serial);
+	WioLTE wio;
+	AtSerial atSerial(&serialApi, &wio);
+	AtPattern prompt("^> ");
+	std::string corpus = BuildWaitingCorpus() + "> ";
+
+	serialApi.Begin(921600);
+	double framerTime = 1e30;
+	double legacyTime = 1e30;
+	double uartTime = 1e30;
+	for (int i = 0; i < TRIAL_NUM; i++) {
+		Deliver(serial, corpus);
+		double start = NowNanos();
+		bool framed = atSerial.ReadResponse(prompt, 1000, NULL);
+		double time = NowNanos() - start;
+		CHECK(framed);
+		if (time < framerTime) framerTime = time;
+
+		Deliver(serial, corpus);
+		start = NowNanos();
+		framed = LegacyReadResponse(serialApi, wio, prompt.GetString());
+		time = NowNanos() - start;
+		CHECK(framed);
+		if (time < legacyTime) legacyTime = time;
+
+		Deliver(serial, corpus);
+		start = NowNanos();
+		Drain(serialApi, corpus.size());
+		time = NowNanos() - start;
+		if (time < uartTime) uartTime = time;
+	}
+
+	// Both read through the same UART model, whose cost is taken out.
+	printf("     framer %.1f[nsec./byte], per-byte slre rescan %.1f[nsec./byte], UART model %.1f[nsec./byte]\n", (framerTime - uartTime) / corpus.size(), (legacyTime - uartTime) / corpus.size(), uartTime / corpus.size());
+	CHECK(framerTime < legacyTime);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////
+// Patterns
+
+// The response patterns of WioLTE.cpp.
+static const char* const DRIVER_PATTERNS[] = {
+	"^([0-9A-Z_]+)$", "^([0-9]+)$",		// Identity values, read once and left to slre.
+	"^OK$", "^(OK|ERROR)$", "^ERROR$", "^\\+CPIN: READY$", "^\\+CME ERROR: .*$", "^\\+CME ERROR: (.*)$", "^\\+CMGL: (.*)$",
+	"^\\+QCCID: (.*)$", "^\\+CNUM: (.*)$", "^\\+QISTATE: (.*)$", "^SEND OK$", "^SEND FAIL$",
+	"^CONNECT$", "^RDY$", "^> ", "^(.*)$", "^\\+CCLK: (.*)$", "^\\+CMGR: .*$", "^\\+QHTTPREAD: 0$", "^\\+QIRD: (.*)$", "^\\+QNTP: (.*)$",
+};
+
+static const char* const MODULE_LINES[] = {
+	"OK", "ERROR", "+CPIN: READY", "+CME ERROR: 10", "+CMGL: 1,\"REC UNREAD\",,23", "EC21JFAR06A03M4G", "866000000000001",
+	"+QCCID: 8981100000000000001F", "+CNUM: ,\"09012345678\",129", "+QISTATE: 0,\"TCP\",\"192.0.2.1\",80,0,2,1,0,0,\"uart1\"",
+	"SEND OK", "CONNECT", "RDY", "> ", "+CSQ: 20,99", "+CREG: 0,1", "+CGREG: 0,1", "+CEREG: 2,5,\"1A2B\",\"0123ABCD\",7",
+	"+QCELLLOC: 139.700000,35.600000", "+QHTTPGET: 0,200,1024", "+QHTTPPOST: 702", "+QIRD: 10,5,0", "+QIRD: 5", "+QIURC: \"recv\",0",
+	"+QGPSLOC: 021410.0,3536.0000N,13942.0000E,1.0,40.5,3,0.00,0.0,0.0,161026,08", "+CCLK: \"26/10/16,12:00:00+36\"",
+};
+
+#define SLRE_PATTERN_NUM	(2)
+#define MATCH_REPEAT_NUM	(200)
+#define CAPTURE_MAX			(16)
+
+static void TestPatterns()
+{
+	AtFields<int, int> csq("+CSQ: ");
+	AtFields<int, int> creg("+CREG: ");
+	AtFields<int, int> cgreg("+CGREG: ");
+	AtFields<int, int> cereg("+CEREG: ");
+	AtFields<double, double> qcellloc("+QCELLLOC: ");
+	AtFields<int, int, int> qhttpget("+QHTTPGET: ");
+	AtFields<int> qhttppost("+QHTTPPOST: ");
+	AtFields<int, int, int> qird("+QIRD: ");
+	AtFields<AtString, AtString, AtString, AtString, double, AtString, AtString, AtString, AtString, AtString> qgpsloc("+QGPSLOC: ");
+
+	std::vector<AtPattern> patterns;
+	for (size_t i = 0; i < sizeof (DRIVER_PATTERNS) / sizeof (DRIVER_PATTERNS[0]); i++) patterns.push_back(AtPattern(DRIVER_PATTERNS[i]));
+	const AtPattern* fieldPatterns[] = { &csq.GetPattern(), &creg.GetPattern(), &cgreg.GetPattern(), &cereg.GetPattern(), &qcellloc.GetPattern(), &qhttpget.GetPattern(), &qhttppost.GetPattern(), &qird.GetPattern(), &qgpsloc.GetPattern() };
+	for (size_t i = 0; i < sizeof (fieldPatterns) / sizeof (fieldPatterns[0]); i++) patterns.push_back(*fieldPatterns[i]);
+
+	// Same results, and only the identity patterns left to slre.
+	int matchNum = 0;
+	for (size_t i = 0; i < patterns.size(); i++) {
+		CHECK(patterns[i].IsCompiled() == (i >= SLRE_PATTERN_NUM));
+		for (size_t j = 0; j < sizeof (MODULE_LINES) / sizeof (MODULE_LINES[0]); j++) {
+			const char* line = MODULE_LINES[j];
+			slre_cap captures[CAPTURE_MAX];
+			slre_cap slreCaptures[CAPTURE_MAX];
+			memset(captures, 0, sizeof (captures));
+			memset(slreCaptures, 0, sizeof (slreCaptures));
+			bool matched = patterns[i].Match(line, strlen(line), captures, CAPTURE_MAX);
+			CHECK(matched == (slre_match(patterns[i].GetString(), line, strlen(line), slreCaptures, CAPTURE_MAX, 0) >= 1));
+			if (!matched) continue;
+			matchNum++;
+			for (int k = 0; k < CAPTURE_MAX; k++) {
+				if (slreCaptures[k].len >= 1) CHECK(captures[k].ptr == slreCaptures[k].ptr && captures[k].len == slreCaptures[k].len);
+			}
+		}
+	}
+
+	double compiledTime = 1e30;
+	double slreTime = 1e30;
+	int attemptNum = patterns.size() * (sizeof (MODULE_LINES) / sizeof (MODULE_LINES[0]));
+	for (int trial = 0; trial < TRIAL_NUM; trial++) {
+		slre_cap captures[CAPTURE_MAX];
+		int compiledMatchNum = 0;
+		int slreMatchNum = 0;
+
+		double start = NowNanos();
+		for (int n = 0; n < MATCH_REPEAT_NUM; n++) {
+			for (size_t i = 0; i < patterns.size(); i++) {
+				for (size_t j = 0; j < sizeof (MODULE_LINES) / sizeof (MODULE_LINES[0]); j++) {
+					if (patterns[i].Match(MODULE_LINES[j], strlen(MODULE_LINES[j]), captures, CAPTURE_MAX)) compiledMatchNum++;
+				}
+			}
+		}
+		double time = NowNanos() - start;
+		if (time < compiledTime) compiledTime = time;
+
+		start = NowNanos();
+		for (int n = 0; n < MATCH_REPEAT_NUM; n++) {
+			for (size_t i = 0; i < patterns.size(); i++) {
+				for (size_t j = 0; j < sizeof (MODULE_LINES) / sizeof (MODULE_LINES[0]); j++) {
+					if (slre_match(patterns[i].GetString(), MODULE_LINES[j], strlen(MODULE_LINES[j]), captures, CAPTURE_MAX, 0) >= 1) slreMatchNum++;
+				}
+			}
+		}
+		time = NowNanos() - start;
+		if (time < slreTime) slreTime = time;
+
+		CHECK(compiledMatchNum == matchNum * MATCH_REPEAT_NUM && slreMatchNum == compiledMatchNum);
+	}
+
+	printf("     %d patterns x %d lines: AtPattern %.1f[nsec./match], slre %.1f[nsec./match]\n", (int)patterns.size(), attemptNum / (int)patterns.size(), compiledTime / (attemptNum * MATCH_REPEAT_NUM), slreTime / (attemptNum * MATCH_REPEAT_NUM));
+	CHECK(compiledTime < slreTime);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////
+// Upload
+
+// Virtual time, so the figures are exact. The module answers at once, and what is left above the line time is the library's.
+#define UPLOAD_SIZE			(14600)
+#define OLD_PACING_SIZE		(80)	// The former WriteBinary slept 1 msec. after every 80 bytes.
+
+static double LineTime(int size, unsigned long baud)
+{
+	return size * 10.0 * 1000 / baud;	// [msec.]
+}
+
+static void PrintUpload(const char* name, int size, unsigned long time, unsigned long baud)
+{
+	printf("     %s %d bytes in %lu[msec.], line time %.0f[msec.], %.0f%% of line rate\n", name, size, time, LineTime(size, baud), LineTime(size, baud) * 100 / time);
+}
+
+static void TestUpload()
+{
+	Ec21Emulator module(SerialModule);
+	WioLTE wio;
+	std::string data(UPLOAD_SIZE, 'x');
+	int responseCode;
+
+	CHECK(TestStart(wio));
+	module.SetResponseLatency(0);
+	module.SetSendLatency(0);
+	module.SetHttpLatency(0);
+	unsigned long baud = SerialModule.GetBaud();
+
+	int connectId = wio.SocketOpen("example.com", 80, WIO_TCP);
+	unsigned long start = millis();
+	CHECK(wio.SocketSend(connectId, (const byte*)data.data(), data.size()));
+	unsigned long time = millis() - start;
+	PrintUpload("SocketSend", data.size(), time, baud);
+	CHECK(time < LineTime(data.size(), baud) + data.size() / OLD_PACING_SIZE);	// Faster than the sleeps of the old pacing alone would allow.
+	CHECK(wio.SocketClose(connectId));
+
+	start = millis();
+	CHECK(wio.HttpPost("http://example.com/post", data.c_str(), &responseCode));
+	time = millis() - start;
+	int size = module.GetHttpRequest().size();
+	PrintUpload("HttpPost", size, time, baud);
+	CHECK(time < LineTime(size, baud) + size / OLD_PACING_SIZE);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////
+// Decoding
+
+// ArgumentParser before the zero-copy one: comma positions in a vector, then a vector per argument.
+class LegacyArgumentParser
+{
+private:
+	std::vector< std::vector<char> > _Arguments;
+
+public:
+	void Parse(const char* str)
+	{
+		_Arguments.clear();
+
+		std::vector<const char*> commaList;
+		bool inString = false;
+		for (const char* ptr = str; *ptr != '\0'; ptr++) {
+			if (*ptr == '"') inString = !inString;
+			if (!inString && *ptr == ',') commaList.push_back(ptr);
+		}
+
+		_Arguments.resize(commaList.size() + 1);
+		for (int i = 0; i < (int)_Arguments.size(); i++) {
+			const char* begin = i == 0 ? str : commaList[i - 1] + 1;
+			const char* end = i < (int)commaList.size() ? commaList[i] : str + strlen(str);
+			if (end - begin >= 2 && *begin == '"' && *(end - 1) == '"') {
+				begin++;
+				end--;
+			}
+			_Arguments[i].resize(end - begin + 1);
+			memcpy(&_Arguments[i][0], begin, end - begin);
+			_Arguments[i][end - begin] = '\0';
+		}
+	}
+
+	int Size() const { return _Arguments.size(); }
+	const char* operator[](int index) const { return &_Arguments[index][0]; }
+
+};
+
+#define DECODE_REPEAT_NUM	(2000)
+
+static const char* const CEREG_LINE = "+CEREG: 2,5,\"1A2B\",\"0123ABCD\",7";
+static const char* const QGPSLOC_LINE = "+QGPSLOC: 021410.0,3536.0000N,13942.0000E,1.0,40.5,3,0.00,0.0,0.0,161026,08";
+
+// As the driver did: one capture of the whole line into a std::string, then the legacy parser.
+static double LegacyDecode(const char* pattern, const char* line, int prefixLength)
+{
+	slre_cap cap;
+	if (slre_match(pattern, line, strlen(line), &cap, 1, 0) < 1) return 0;
+	std::string response(cap.ptr, cap.len);
+	LegacyArgumentParser parser;
+	parser.Parse(&response.c_str()[prefixLength]);
+	if (parser.Size() < 5) return 0;
+
+	return atoi(parser[1]) + atof(parser[4]);
+}
+
+template<typename... Types>
+static double DecodeTime(const AtFields<Types...>& fields, const char* line, double (*decode)(const AtFields<Types...>&, const slre_cap*), double* value, unsigned long* allocationNum)
+{
+	slre_cap captures[AtFields<Types...>::CAPTURE_NUM];
+	double best = 1e30;
+	for (int trial = 0; trial < TRIAL_NUM; trial++) {
+		HostAllocation::Start();
+		double start = NowNanos();
+		*value = 0;
+		for (int i = 0; i < DECODE_REPEAT_NUM; i++) {
+			if (fields.GetPattern().Match(line, strlen(line), captures, AtFields<Types...>::CAPTURE_NUM)) *value += decode(fields, captures);
+		}
+		double time = NowNanos() - start;
+		*allocationNum = HostAllocation::Stop();
+		if (time < best) best = time;
+	}
+
+	return best / DECODE_REPEAT_NUM;
+}
+
+static double LegacyDecodeTime(const char* pattern, const char* line, int prefixLength, double* value, unsigned long* allocationNum)
+{
+	double best = 1e30;
+	for (int trial = 0; trial < TRIAL_NUM; trial++) {
+		HostAllocation::Start();
+		double start = NowNanos();
+		*value = 0;
+		for (int i = 0; i < DECODE_REPEAT_NUM; i++) *value += LegacyDecode(pattern, line, prefixLength);
+		double time = NowNanos() - start;
+		*allocationNum = HostAllocation::Stop();
+		if (time < best) best = time;
+	}
+
+	return best / DECODE_REPEAT_NUM;
+}
+
+typedef AtFields<int, int, AtString, AtString, int> CeregFields;
+typedef AtFields<AtString, AtString, AtString, AtString, double, AtString, AtString, AtString, AtString, AtString> QgpslocFields;
+
+static double DecodeCereg(const CeregFields& fields, const slre_cap* captures)
+{
+	int stat;
+	int act;
+	fields.Decode(captures, NULL, &stat, NULL, NULL, &act);
+	return stat + act;
+}
+
+static double DecodeQgpsloc(const QgpslocFields& fields, const slre_cap* captures)
+{
+	AtString lat;
+	double alt;
+	fields.Decode(captures, NULL, &lat, NULL, NULL, &alt, NULL, NULL, NULL, NULL, NULL);
+	return atoi(lat.Ptr) + alt;
+}
+
+static void TestDecoding()
+{
+	CeregFields cereg("+CEREG: ");
+	QgpslocFields qgpsloc("+QGPSLOC: ");
+	double value;
+	double legacyValue;
+	unsigned long allocationNum;
+	unsigned long legacyAllocationNum;
+
+	double time = DecodeTime(cereg, CEREG_LINE, DecodeCereg, &value, &allocationNum);
+	double legacyTime = LegacyDecodeTime("^(OK|\\+CEREG: .*)$", CEREG_LINE, 8, &legacyValue, &legacyAllocationNum);
+	printf("     +CEREG: fields %.1f[nsec./line] %lu allocations/line, single capture and legacy parser %.1f[nsec./line] %lu allocations/line\n", time, allocationNum / DECODE_REPEAT_NUM, legacyTime, legacyAllocationNum / DECODE_REPEAT_NUM);
+	CHECK(value == legacyValue && value == 12 * DECODE_REPEAT_NUM);
+	CHECK(allocationNum == 0 && legacyAllocationNum >= 1);
+	CHECK(time < legacyTime);
+
+	time = DecodeTime(qgpsloc, QGPSLOC_LINE, DecodeQgpsloc, &value, &allocationNum);
+	legacyTime = LegacyDecodeTime("^(OK|\\+QGPSLOC: .*|\\+CME ERROR: .*)$", QGPSLOC_LINE, 10, &legacyValue, &legacyAllocationNum);
+	printf("     +QGPSLOC: fields %.1f[nsec./line] %lu allocations/line, single capture and legacy parser %.1f[nsec./line] %lu allocations/line\n", time, allocationNum / DECODE_REPEAT_NUM, legacyTime, legacyAllocationNum / DECODE_REPEAT_NUM);
+	CHECK(value == legacyValue && value == (3536 + 40.5) * DECODE_REPEAT_NUM);
+	CHECK(allocationNum == 0 && legacyAllocationNum >= 1);
+	CHECK(time < legacyTime);
+
+	// The same paths in the driver allocate nothing either.
+	Ec21Emulator module(SerialModule);
+	WioLTE wio;
+	double longitude;
+	double latitude;
+	CHECK(TestStart(wio, false));
+	CHECK(wio.EnableGNSS());
+	module.SetGnssFix("021410.0,3536.0000N,13942.0000E,1.0,40.5,3,0.00,0.0,0.0,161026,08");
+	HostAllocation::Start();
+	int rssi = wio.GetReceivedSignalStrength();
+	bool located = wio.GetGNSSLocation(&longitude, &latitude);
+	allocationNum = HostAllocation::Stop();
+	CHECK(rssi == -73 && located);
+	CHECK(allocationNum == 0);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////
+// Tokenizer
+
+#define PARSE_REPEAT_NUM	(2000)
+
+// Argument parts of the lines read while registering and syncing the socket table.
+static const char* const ARGUMENT_LINES[] = {
+	"0,1",
+	"2,5,\"1A2B\",\"0123ABCD\",7",
+	"2,1,\"1A2B\",\"0123ABCD\",7,\"01\"",
+	"0,\"TCP\",\"192.0.2.1\",80,0,2,1,0,0,\"uart1\"",
+};
+
+static void TestTokenizer()
+{
+	const int lineNum = sizeof (ARGUMENT_LINES) / sizeof (ARGUMENT_LINES[0]);
+	double parserTime = 1e30;
+	double legacyTime = 1e30;
+	unsigned long allocationNum = 0;
+	unsigned long legacyAllocationNum = 0;
+	long sum = 0;
+	long legacySum = 0;
+	for (int trial = 0; trial < TRIAL_NUM; trial++) {
+		HostAllocation::Start();
+		double start = NowNanos();
+		sum = 0;
+		for (int n = 0; n < PARSE_REPEAT_NUM; n++) {
+			for (int i = 0; i < lineNum; i++) {
+				ArgumentParser parser;
+				parser.Parse(ARGUMENT_LINES[i]);
+				sum += parser.Size() + parser.AsInt(1) + parser.Length(parser.Size() - 1);
+			}
+		}
+		double time = NowNanos() - start;
+		allocationNum = HostAllocation::Stop();
+		if (time < parserTime) parserTime = time;
+
+		HostAllocation::Start();
+		start = NowNanos();
+		legacySum = 0;
+		for (int n = 0; n < PARSE_REPEAT_NUM; n++) {
+			for (int i = 0; i < lineNum; i++) {
+				LegacyArgumentParser parser;
+				parser.Parse(ARGUMENT_LINES[i]);
+				legacySum += parser.Size() + atoi(parser[1]) + strlen(parser[parser.Size() - 1]);
+			}
+		}
+		time = NowNanos() - start;
+		legacyAllocationNum = HostAllocation::Stop();
+		if (time < legacyTime) legacyTime = time;
+	}
+
+	int parseNum = PARSE_REPEAT_NUM * lineNum;
+	printf("     ArgumentParser %.1f[nsec./line] %lu allocations/line, legacy %.1f[nsec./line] %lu allocations/line\n", parserTime / parseNum, allocationNum / parseNum, legacyTime / parseNum, legacyAllocationNum / parseNum);
+	CHECK(sum == legacySum);
+	CHECK(allocationNum == 0);
+	CHECK(parserTime < legacyTime);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////
+// Command formatting
+
+#define FORMAT_REPEAT_NUM	(2000)
+
+// StringBuilder before the fixed-capacity one: vsnprintf into a 200-byte temporary, then appended to a vector.
+class LegacyStringBuilder
+{
+private:
+	std::vector<char> _Buffer;
+
+public:
+	LegacyStringBuilder() { _Buffer.push_back('\0'); }
+
+	const char* GetString() const { return &_Buffer[0]; }
+
+	void Write(const char* str)
+	{
+		int i = _Buffer.size() - 1;
+		_Buffer.resize(_Buffer.size() + strlen(str));
+		strcpy(&_Buffer[i], str);
+	}
+
+	bool WriteFormat(const char* format, ...)
+	{
+		va_list arglist;
+		va_start(arglist, format);
+		char str[200];
+		int length = vsnprintf(str, sizeof (str), format, arglist);
+		va_end(arglist);
+		if (length < 0 || (int)(sizeof (str) - 1) <= length) return false;
+
+		Write(str);
+		return true;
+	}
+
+};
+
+static void TestCommandFormatting()
+{
+	double builderTime = 1e30;
+	double legacyTime = 1e30;
+	unsigned long allocationNum = 0;
+	unsigned long legacyAllocationNum = 0;
+	size_t length = 0;
+	size_t legacyLength = 0;
+	for (int trial = 0; trial < TRIAL_NUM; trial++) {
+		// AT+QIOPEN once, then AT+QISEND for each segment, as SocketOpen and SocketSend build them.
+		HostAllocation::Start();
+		double start = NowNanos();
+		length = 0;
+		for (int n = 0; n < FORMAT_REPEAT_NUM; n++) {
+			StringBuilder<200> open;
+			open.Write("AT+QIOPEN=1,");
+			open.WriteInt(n % 12);
+			open.Write(",");
+			open.WriteQuoted("TCP");
+			open.Write(",");
+			open.WriteQuoted("example.com");
+			open.Write(",");
+			open.WriteInt(80);
+			length += open.IsOverflow() ? 0 : strlen(open.GetString());
+
+			StringBuilder<32> send;
+			send.Write("AT+QISEND=");
+			send.WriteInt(n % 12);
+			send.Write(",");
+			send.WriteInt(1460);
+			length += send.IsOverflow() ? 0 : strlen(send.GetString());
+		}
+		double time = NowNanos() - start;
+		allocationNum = HostAllocation::Stop();
+		if (time < builderTime) builderTime = time;
+
+		HostAllocation::Start();
+		start = NowNanos();
+		legacyLength = 0;
+		for (int n = 0; n < FORMAT_REPEAT_NUM; n++) {
+			LegacyStringBuilder open;
+			if (open.WriteFormat("AT+QIOPEN=1,%d,\"%s\",\"%s\",%d", n % 12, "TCP", "example.com", 80)) legacyLength += strlen(open.GetString());
+
+			LegacyStringBuilder send;
+			if (send.WriteFormat("AT+QISEND=%d,%d", n % 12, 1460)) legacyLength += strlen(send.GetString());
+		}
+		time = NowNanos() - start;
+		legacyAllocationNum = HostAllocation::Stop();
+		if (time < legacyTime) legacyTime = time;
+	}
+
+	int commandNum = FORMAT_REPEAT_NUM * 2;
+	printf("     StringBuilder<N> %.1f[nsec./command] %lu allocations/command, vsnprintf and vector %.1f[nsec./command] %lu allocations/command\n", builderTime / commandNum, allocationNum / commandNum, legacyTime / commandNum, legacyAllocationNum / commandNum);
+	CHECK(length == legacyLength);
+	CHECK(allocationNum == 0);
+	CHECK(builderTime < legacyTime);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////
+// Readiness
+
+#define POLL_SOCKET_NUM		(3)
+#define POLL_MESSAGE_NUM	(12)
+#define POLL_MESSAGE_GAP	(1000)	// [msec.]
+#define POLL_INTERVAL		(100)	// [msec.] of a sketch that asks every socket in turn.
+
+// Messages arrive on the sockets in turn, one every POLL_MESSAGE_GAP. Returns the virtual time taken to receive them all.
+static unsigned long ReceiveMessages(Ec21Emulator& module, WioLTE& wio, const int* connectIds, bool poll)
+{
+	for (int i = 0; i < POLL_MESSAGE_NUM; i++) {
+		int connectId = connectIds[i % POLL_SOCKET_NUM];
+		module.Schedule((i + 1) * POLL_MESSAGE_GAP, [&module, connectId]() { module.PushSocketData(connectId, "message"); });
+	}
+
+	unsigned long start = millis();
+	int receivedNum = 0;
+	char data[100];
+	while (receivedNum < POLL_MESSAGE_NUM && millis() - start < (POLL_MESSAGE_NUM + 5) * POLL_MESSAGE_GAP) {
+		int events[POLL_SOCKET_NUM];
+		if (poll && wio.SocketPoll(connectIds, events, POLL_SOCKET_NUM, 10000) <= 0) continue;
+		for (int i = 0; i < POLL_SOCKET_NUM; i++) {
+			if (poll && (events[i] & WIO_SOCKET_READABLE) == 0) continue;
+			if (wio.SocketReceive(connectIds[i], data, sizeof (data)) > 0) receivedNum++;
+		}
+		if (!poll) delay(POLL_INTERVAL);
+	}
+	CHECK(receivedNum == POLL_MESSAGE_NUM);
+
+	return millis() - start;
+}
+
+static void TestReadiness()
+{
+	Ec21Emulator module(SerialModule);
+	WioLTE wio;
+	int connectIds[POLL_SOCKET_NUM];
+
+	CHECK(TestStart(wio));
+	for (int i = 0; i < POLL_SOCKET_NUM; i++) connectIds[i] = wio.SocketOpen("example.com", 80 + i, i == 0 ? WIO_TCP : WIO_UDP);
+
+	module.ClearCommands();
+	unsigned long pollTime = ReceiveMessages(module, wio, connectIds, true);
+	int pollQueryNum = module.CountCommands("AT+QIRD");
+
+	module.ClearCommands();
+	unsigned long eachTime = ReceiveMessages(module, wio, connectIds, false);
+	int eachQueryNum = module.CountCommands("AT+QIRD");
+
+	printf("     %d messages on %d sockets: SocketPoll %d AT+QIRD in %lu[msec.], SocketReceive on each socket every %d[msec.] %d AT+QIRD in %lu[msec.]\n", POLL_MESSAGE_NUM, POLL_SOCKET_NUM, pollQueryNum, pollTime, POLL_INTERVAL, eachQueryNum, eachTime);
+	CHECK(pollQueryNum <= POLL_MESSAGE_NUM * 2);		// The read, and at most one query per wait.
+	CHECK(pollQueryNum * 10 < eachQueryNum);
+}
+
+int main()
+{
+	TestRun("Framer", TestFramer);
+	TestRun("Patterns", TestPatterns);
+	TestRun("Upload", TestUpload);
+	TestRun("Decoding", TestDecoding);
+	TestRun("Tokenizer", TestTokenizer);
+	TestRun("CommandFormatting", TestCommandFormatting);
+	TestRun("Readiness", TestReadiness);
+
+	return TestResult();
+}
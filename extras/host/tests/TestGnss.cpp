@@ -0,0 +1,53 @@
+#include "Test.h"
+
+static void TestLocation()
+{
+	Ec21Emulator module(SerialModule);
+	WioLTE wio;
+	double longitude;
+	double latitude;
+	double altitude;
+	struct tm tim;
+
+	CHECK(TestStart(wio, false));
+	CHECK(!wio.GetGNSSLocation(&longitude, &latitude));
+	CHECK(wio.EnableGNSS());
+	CHECK(!wio.GetGNSSLocation(&longitude, &latitude));
+	CHECK(wio.GetLastError() == WioLTE::E_GNSS_NOT_FIXED);
+
+	module.SetGnssFix("021410.0,3536.0000N,13942.0000W,1.0,40.5,3,0.00,0.0,0.0,161026,08");
+	CHECK(wio.GetGNSSLocation(&longitude, &latitude, &altitude, &tim));
+	CHECK(latitude > 35.5999 && latitude < 35.6001);
+	CHECK(longitude < -139.6999 && longitude > -139.7001);
+	CHECK(altitude == 40.5);
+	CHECK(tim.tm_year == 126 && tim.tm_mon == 9 && tim.tm_mday == 16 && tim.tm_hour == 2 && tim.tm_min == 14);
+
+	CHECK(wio.DisableGNSS());
+}
+
+static void TestEnableError()
+{
+	Ec21Emulator module(SerialModule);
+	WioLTE wio;
+
+	CHECK(TestStart(wio, false));
+	CHECK(wio.EnableGNSS());
+	unsigned long start = millis();
+	CHECK(!wio.EnableGNSS());
+	CHECK(millis() - start < 500);
+	CHECK(wio.GetLastError() == WioLTE::E_MODULE_ERROR);
+	CHECK(wio.GetLastModuleError() == 504);	// Session is ongoing.
+
+	CHECK(wio.DisableGNSS());
+	CHECK(!wio.DisableGNSS());
+	CHECK(wio.GetLastError() == WioLTE::E_MODULE_ERROR);
+	CHECK(wio.GetLastModuleError() == 505);	// Session not active.
+}
+
+int main()
+{
+	TestRun("Location", TestLocation);
+	TestRun("EnableError", TestEnableError);
+
+	return TestResult();
+}
@@ -0,0 +1,81 @@
+#include "Test.h"
+#include <string.h>
+
+static void TestGet()
+{
+	Ec21Emulator module(SerialModule);
+	WioLTE wio;
+	char data[100];
+
+	CHECK(TestStart(wio));
+	module.SetHttpResponse(200, "{\"value\":1}");
+	CHECK(wio.HttpGet("http://example.com/path?q=1", data, sizeof (data)) == 11);
+	CHECK(strcmp(data, "{\"value\":1}") == 0);
+	CHECK(module.GetHttpUrl() == "http://example.com/path?q=1");
+
+	const std::string& request = module.GetHttpRequest();
+	CHECK(request.find("GET /path?q=1 HTTP/1.1\r\nHost: example.com\r\n") == 0);
+	CHECK(request.find("\r\nUser-Agent: QUECTEL_MODULE\r\n") != std::string::npos);
+	CHECK(request.compare(request.size() - 4, 4, "\r\n\r\n") == 0);
+
+	CHECK(wio.HttpGet("http://example.com/", data, 5) == -1);
+}
+
+static void TestGetWithHeader()
+{
+	Ec21Emulator module(SerialModule);
+	WioLTE wio;
+	char data[100];
+	WioLTEHttpHeader header;
+
+	CHECK(TestStart(wio));
+	header["Authorization"] = "Bearer token";
+	module.SetHttpResponse(200, "ok");
+	CHECK(wio.HttpGet("https://example.com", data, sizeof (data), header) == 2);
+	CHECK(module.GetHttpRequest().find("GET / HTTP/1.1\r\n") == 0);
+	CHECK(module.GetHttpRequest().find("\r\nAuthorization: Bearer token\r\n") != std::string::npos);
+}
+
+static void TestPost()
+{
+	Ec21Emulator module(SerialModule);
+	WioLTE wio;
+	int responseCode;
+
+	CHECK(TestStart(wio));
+	module.SetHttpResponse(201, "");
+	CHECK(wio.HttpPost("http://example.com/post", "{\"a\":2}", &responseCode));
+	CHECK(responseCode == 201);
+	const std::string& request = module.GetHttpRequest();
+	CHECK(request.find("POST /post HTTP/1.1\r\n") == 0);
+	CHECK(request.find("\r\nContent-Length: 7\r\n") != std::string::npos);
+	CHECK(request.compare(request.size() - 11, 11, "\r\n\r\n{\"a\":2}") == 0);
+}
+
+static void TestPostCommandOverflow()
+{
+	Ec21Emulator module(SerialModule);
+	WioLTE wio;
+	int responseCode;
+	int postNum = 0;
+
+	CHECK(TestStart(wio));
+	module.SetCommandHook([&postNum](const std::string& command) {
+		if (command.compare(0, 13, "AT+QHTTPPOST=") == 0) postNum++;
+		return false;
+	});
+	// "AT+QHTTPPOST=<length>,2000000,2000000" does not fit the command buffer, and is not sent cut short.
+	CHECK(!wio.HttpPost("http://example.com/post", "{\"a\":2}", &responseCode, 2000000000));
+	CHECK(wio.GetLastError() == WioLTE::E_UNKNOWN);
+	CHECK(postNum == 0);
+}
+
+int main()
+{
+	TestRun("Get", TestGet);
+	TestRun("GetWithHeader", TestGetWithHeader);
+	TestRun("Post", TestPost);
+	TestRun("PostCommandOverflow", TestPostCommandOverflow);
+
+	return TestResult();
+}
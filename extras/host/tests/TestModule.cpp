@@ -0,0 +1,272 @@
+#include "Test.h"
+#include <string.h>
+#include <limits.h>
+
+static void TestTurnOn()
+{
+	Ec21Emulator module(SerialModule);
+	WioLTE wio;
+
+	CHECK(TestStart(wio, false));
+	CHECK(module.IsOn());
+	CHECK(module.CountCommands("ATE0") == 1);
+	CHECK(module.CountCommands("AT+CGREG=1") == 1);
+}
+
+static void TestReset()
+{
+	Ec21Emulator module(SerialModule);
+	WioLTE wio;
+
+	AtStatistics statistics;
+
+	CHECK(TestStart(wio, false));
+	module.ClearCommands();
+	wio.GetStatistics(&statistics, true);
+	CHECK(wio.TurnOnOrReset());
+	CHECK(module.IsOn());
+	CHECK(module.CountCommands("ATE0") == 1);
+
+	// The boot is not added to the AT that found the module on.
+	wio.GetStatistics(&statistics);
+	const AtStatistics::Entry* entry = statistics.Find("RDY");
+	CHECK(entry != NULL && entry->Count == 1 && entry->TimeoutCount == 0 && entry->MaxTime >= 4000);
+	entry = statistics.Find("AT");
+	CHECK(entry != NULL && entry->TimeoutCount == 0 && entry->MaxTime < 100);
+}
+
+static void TestBaud()
+{
+	Ec21Emulator module(SerialModule);
+	WioLTE wio;
+
+	wio.SetModuleBaud(921600);
+	CHECK(TestStart(wio, false));
+	CHECK(module.GetBaud() == 921600);
+	CHECK(module.CountCommands("AT&W") == 1);
+
+	// The saved rate survives a reset.
+	module.ClearCommands();
+	CHECK(wio.TurnOnOrReset());
+	CHECK(module.GetBaud() == 921600);
+	CHECK(module.CountCommands("AT+IPR") == 0);
+	CHECK(wio.GetReceivedSignalStrength() != INT_MIN);
+}
+
+static void TestBaudSavedByOther()
+{
+	Ec21Emulator module(SerialModule);
+
+	{
+		WioLTE wio;
+		wio.SetModuleBaud(921600);
+		CHECK(TestStart(wio, false));
+	}
+
+	// The saved rate is found, and the requested one saved over it.
+	{
+		WioLTE wio;
+		wio.SetModuleBaud(460800);
+		CHECK(TestStart(wio, false));
+		CHECK(module.GetBaud() == 460800);
+		CHECK(wio.GetReceivedSignalStrength() != INT_MIN);
+	}
+	{
+		WioLTE wio;
+		CHECK(TestStart(wio, false));
+		CHECK(module.GetBaud() == 115200);
+	}
+
+	// Also when the module is off and boots at the saved rate.
+	{
+		WioLTE wio;
+		wio.SetModuleBaud(921600);
+		CHECK(TestStart(wio, false));
+		CHECK(wio.TurnOff());
+	}
+	{
+		WioLTE wio;
+		CHECK(TestStart(wio, false));
+		CHECK(module.GetBaud() == 115200);
+		CHECK(wio.GetReceivedSignalStrength() != INT_MIN);
+	}
+}
+
+static void TestBaudFallback()
+{
+	Ec21Emulator module(SerialModule);
+	WioLTE wio;
+
+	// The module accepts the rate but does not switch to it.
+	module.SetCommandHook([&module](const std::string& command) {
+		if (command.compare(0, 7, "AT+IPR=") != 0) return false;
+		module.Reply("OK");
+		return true;
+	});
+	wio.SetModuleBaud(921600);
+	CHECK(TestStart(wio, false));
+	CHECK(module.GetBaud() == 115200);
+	CHECK(module.CountCommands("AT&W") == 0);
+
+#ifdef WIO_TRACE
+	Trace::Event events[Trace::EVENT_NUM];
+	int eventNum = wio.ReadTrace(events, Trace::EVENT_NUM);
+	bool fallback = false;
+	for (int i = 0; i < eventNum; i++) {
+		if (events[i].Id == Trace::EVENT_BAUD_FALLBACK && events[i].Arg1 == 115200) fallback = true;
+	}
+	CHECK(fallback);
+#endif // WIO_TRACE
+}
+
+static void TestTraceLost()
+{
+	Ec21Emulator module(SerialModule);
+	WioLTE wio;
+
+	CHECK(TestStart(wio, false));
+#ifdef WIO_TRACE
+	Trace::Event event;
+	while (wio.ReadTrace(&event, 1) >= 1);
+	unsigned long lostNum = wio.GetTraceLostNum();
+	for (int i = 0; i < Trace::EVENT_NUM; i++) wio.GetReceivedSignalStrength();	// A command and its responses each.
+	CHECK(wio.GetTraceLostNum() >= lostNum + Trace::EVENT_NUM);
+#else
+	CHECK(wio.GetTraceLostNum() == 0);
+#endif // WIO_TRACE
+}
+
+static void TestIdentity()
+{
+	Ec21Emulator module(SerialModule);
+	WioLTE wio;
+	char str[40];
+
+	CHECK(TestStart(wio, false));
+	module.ClearCommands();
+	CHECK(wio.GetRevision(str, sizeof (str)) == 16 && strcmp(str, "EC21JFAR06A03M4G") == 0);
+	CHECK(wio.GetIMEI(str, sizeof (str)) == 15 && strcmp(str, "866000000000001") == 0);
+	CHECK(wio.GetIMSI(str, sizeof (str)) == 15 && strcmp(str, "440100000000001") == 0);
+	CHECK(wio.GetICCID(str, sizeof (str)) == 19 && strcmp(str, "8981100000000000001") == 0);
+	CHECK(wio.GetPhoneNumber(str, sizeof (str)) == 11 && strcmp(str, "09012345678") == 0);
+	CHECK(module.GetCommands().size() == 1);
+	CHECK(wio.GetIMEI(str, 10) == -1);
+}
+
+static void TestIdentityWithoutSim()
+{
+	Ec21Emulator module(SerialModule);
+	WioLTE wio;
+	char str[40];
+
+	CHECK(TestStart(wio, false));
+	module.SetSimReady(false);
+	CHECK(wio.GetIMEI(str, sizeof (str)) == 15 && strcmp(str, "866000000000001") == 0);
+	CHECK(wio.GetRevision(str, sizeof (str)) == 16);
+	CHECK(wio.GetIMSI(str, sizeof (str)) == -1);
+	CHECK(wio.GetICCID(str, sizeof (str)) == -1);
+	CHECK(wio.GetPhoneNumber(str, sizeof (str)) == -1);
+
+	// Read one by one once the SIM is ready.
+	module.SetSimReady(true);
+	CHECK(wio.GetICCID(str, sizeof (str)) == 19 && strcmp(str, "8981100000000000001") == 0);
+	CHECK(wio.GetPhoneNumber(str, sizeof (str)) == 11 && strcmp(str, "09012345678") == 0);
+}
+
+static void TestStatus()
+{
+	Ec21Emulator module(SerialModule);
+	WioLTE wio;
+	struct tm tim;
+
+	CHECK(TestStart(wio, false));
+	CHECK(wio.GetReceivedSignalStrength() == -73);
+	CHECK(wio.GetTime(&tim));
+	CHECK(tim.tm_year == 126 && tim.tm_mon == 9 && tim.tm_mday == 16 && tim.tm_hour == 12);
+	CHECK(wio.WaitForCSRegistration(10000));
+}
+
+static void TestLineLength()
+{
+	Ec21Emulator module(SerialModule);
+	WioLTE wio;
+	std::string longest = "+QIURC: \"" + std::string(AtSerial::RESPONSE_MAX_LENGTH - 10, 'x') + "\"";
+	std::string urc;
+
+	CHECK(TestStart(wio, false));
+	module.SetCommandHook([&module, &longest](const std::string& command) {
+		if (command != "AT+CSQ") return false;
+		module.Reply(longest);
+		module.Reply(longest + "x");
+		module.Reply("+CSQ: 20,99");
+		module.Reply("OK");
+		return true;
+	});
+	wio.SetUrcFunction([&urc](const char* response) { urc = response; });
+	CHECK(longest.size() == AtSerial::RESPONSE_MAX_LENGTH);
+	wio.GetReceivedSignalStrength();
+	CHECK(urc == longest);
+}
+
+static void TestNetwork()
+{
+	Ec21Emulator module(SerialModule);
+	WioLTE wio;
+	double longitude;
+	double latitude;
+
+	CHECK(TestStart(wio));
+	CHECK(module.CountCommands("AT+QIACT=1") == 1);
+	CHECK(wio.SyncTime("ntp.nict.jp"));
+	CHECK(wio.GetLocation(&longitude, &latitude));
+	CHECK(longitude > 139.69 && longitude < 139.71);
+	CHECK(latitude > 35.59 && latitude < 35.61);
+	CHECK(wio.Deactivate());
+}
+
+static void TestRegistrationUrc()
+{
+	Ec21Emulator module(SerialModule);
+	WioLTE wio;
+
+	CHECK(TestStart(wio));
+	module.ClearCommands();
+	CHECK(wio.WaitForPSRegistration(0));
+
+	// +CGREG/+CEREG keep the state, so it is not asked for again.
+	module.SetRegistration(2);
+	delay(100);
+	CHECK(!wio.WaitForPSRegistration(1000));
+	module.Schedule(1000, [&module]() { module.SetRegistration(5); });
+	CHECK(wio.WaitForPSRegistration(5000));
+	CHECK(module.CountCommands("AT+CGREG?") == 0);
+}
+
+static void TestTurnOff()
+{
+	Ec21Emulator module(SerialModule);
+	WioLTE wio;
+
+	CHECK(TestStart(wio, false));
+	CHECK(wio.TurnOff());
+	CHECK(!module.IsOn());
+}
+
+int main()
+{
+	TestRun("TurnOn", TestTurnOn);
+	TestRun("Reset", TestReset);
+	TestRun("Baud", TestBaud);
+	TestRun("BaudSavedByOther", TestBaudSavedByOther);
+	TestRun("BaudFallback", TestBaudFallback);
+	TestRun("TraceLost", TestTraceLost);
+	TestRun("Identity", TestIdentity);
+	TestRun("IdentityWithoutSim", TestIdentityWithoutSim);
+	TestRun("Status", TestStatus);
+	TestRun("LineLength", TestLineLength);
+	TestRun("Network", TestNetwork);
+	TestRun("RegistrationUrc", TestRegistrationUrc);
+	TestRun("TurnOff", TestTurnOff);
+
+	return TestResult();
+}
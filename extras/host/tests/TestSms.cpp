@@ -0,0 +1,97 @@
+#include "Test.h"
+#include <string.h>
+
+// SMS-DELIVER from 09012345678, "hello" in the GSM 7 bit alphabet.
+#define PDU_HELLO	"00" "04" "0B81" "9010325476F8" "00" "00" "62106121435600" "05" "E8329BFD06"
+
+static void TestReceive()
+{
+	Ec21Emulator module(SerialModule);
+	WioLTE wio;
+	char message[100];
+	char dialNumber[20];
+
+	CHECK(TestStart(wio, false));
+	CHECK(wio.ReceiveSMS(message, sizeof (message)) == 0);
+
+	module.AddSms(PDU_HELLO);
+	delay(100);		// For +CMTI.
+	CHECK(wio.ReceiveSMS(message, sizeof (message), dialNumber, sizeof (dialNumber)) == 5);
+	CHECK(strcmp(message, "hello") == 0);
+	CHECK(strcmp(dialNumber, "09012345678") == 0);
+
+	CHECK(wio.DeleteReceivedSMS());
+	CHECK(module.GetSmsCount() == 0);
+	CHECK(wio.ReceiveSMS(message, sizeof (message)) == 0);
+	CHECK(!wio.DeleteReceivedSMS());
+}
+
+static void TestReceiveWithoutListing()
+{
+	Ec21Emulator module(SerialModule);
+	WioLTE wio;
+	char message[100];
+
+	CHECK(TestStart(wio, false));
+	CHECK(wio.ReceiveSMS(message, sizeof (message)) == 0);
+	CHECK(module.CountCommands("AT+CMGL") == 1);
+
+	// +CMTI tells the storage, as long as it holds one message.
+	CHECK(wio.ReceiveSMS(message, sizeof (message)) == 0);
+	module.AddSms(PDU_HELLO);
+	delay(100);
+	CHECK(wio.ReceiveSMS(message, sizeof (message)) == 5);
+	CHECK(wio.DeleteReceivedSMS());
+	CHECK(wio.ReceiveSMS(message, sizeof (message)) == 0);
+	CHECK(module.CountCommands("AT+CMGL") == 1);
+
+	module.AddSms(PDU_HELLO);
+	module.AddSms(PDU_HELLO);
+	delay(100);
+	CHECK(wio.DeleteReceivedSMS());
+	CHECK(module.CountCommands("AT+CMGL") == 2);
+	CHECK(wio.ReceiveSMS(message, sizeof (message)) == 5);
+	CHECK(module.CountCommands("AT+CMGL") == 3);
+	CHECK(wio.DeleteReceivedSMS());
+	CHECK(module.GetSmsCount() == 0);
+	CHECK(wio.ReceiveSMS(message, sizeof (message)) == 0);
+}
+
+static void TestReceiveMissedUrc()
+{
+	Ec21Emulator module(SerialModule);
+	WioLTE wio;
+	char message[100];
+
+	CHECK(TestStart(wio, false));
+	CHECK(module.CountCommands("AT+CNMI=2,1") == 1);
+	CHECK(wio.ReceiveSMS(message, sizeof (message)) == 0);
+
+	// The storage is listed again within a second.
+	module.AddSms(PDU_HELLO, false);
+	delay(100);
+	CHECK(wio.ReceiveSMS(message, sizeof (message)) == 0);
+	delay(1000);
+	CHECK(wio.ReceiveSMS(message, sizeof (message)) == 5);
+	CHECK(strcmp(message, "hello") == 0);
+}
+
+static void TestSend()
+{
+	Ec21Emulator module(SerialModule);
+	WioLTE wio;
+
+	CHECK(TestStart(wio, false));
+	CHECK(wio.SendSMS("09012345678", "hi there"));
+	CHECK(module.GetSentSms().size() == 1 && module.GetSentSms()[0] == "hi there");
+}
+
+int main()
+{
+	TestRun("Receive", TestReceive);
+	TestRun("ReceiveWithoutListing", TestReceiveWithoutListing);
+	TestRun("ReceiveMissedUrc", TestReceiveMissedUrc);
+	TestRun("Send", TestSend);
+
+	return TestResult();
+}
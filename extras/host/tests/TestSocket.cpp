@@ -0,0 +1,315 @@
+#include "Test.h"
+#include <WioLTEClient.h>
+#include <string.h>
+#include <limits.h>
+#include <string>
+
+static void TestOpenSendReceiveClose()
+{
+	Ec21Emulator module(SerialModule);
+	WioLTE wio;
+	char data[100];
+
+	CHECK(TestStart(wio));
+	int connectId = wio.SocketOpen("example.com", 80, WIO_TCP);
+	CHECK(connectId == 0);
+	CHECK(module.IsSocketUsed(connectId));
+
+	CHECK(wio.SocketSend(connectId, "hello"));
+	CHECK(module.GetSocketSentData(connectId) == "hello");
+
+	CHECK(wio.SocketReceive(connectId, data, sizeof (data)) == 0);
+	module.Schedule(300, [&module, connectId]() { module.PushSocketData(connectId, "world"); });
+	CHECK(wio.SocketReceive(connectId, data, sizeof (data), 1000) == 5);
+	CHECK(strcmp(data, "world") == 0);
+
+	CHECK(wio.SocketClose(connectId));
+	CHECK(!module.IsSocketUsed(connectId));
+}
+
+static void TestNoAllocation()
+{
+	Ec21Emulator module(SerialModule);
+	WioLTE wio;
+	char data[100];
+
+	CHECK(TestStart(wio));
+	module.Schedule(1000, [&module]() { module.PushSocketData(0, "world"); });
+
+	HostAllocation::Start();
+	int connectId = wio.SocketOpen("example.com", 80, WIO_TCP);
+	bool sent = wio.SocketSend(connectId, "hello");
+	int receivedSize = wio.SocketReceive(connectId, data, sizeof (data), 2000);
+	bool closed = wio.SocketClose(connectId);
+	unsigned long allocationNum = HostAllocation::Stop();
+
+	CHECK(connectId == 0 && sent && receivedSize == 5 && closed);
+	CHECK(allocationNum == 0);
+
+	HostAllocation::Start();
+	std::string counted(100, 'x');
+	CHECK(HostAllocation::Stop() == 1);
+}
+
+static void TestOpenFailure()
+{
+	Ec21Emulator module(SerialModule);
+	WioLTE wio;
+
+	CHECK(TestStart(wio));
+	module.SetOpenResult(565);	// DNS parse failed.
+	CHECK(wio.SocketOpen("example.com", 80, WIO_TCP) == -1);
+	CHECK(wio.GetLastError() == WioLTE::E_MODULE_ERROR);
+	CHECK(wio.GetLastModuleError() == 565);
+	CHECK(!module.IsSocketUsed(0));
+
+	// The id is free again.
+	CHECK(wio.SocketOpen("example.com", 80, WIO_TCP) == 0);
+}
+
+static void TestOpenTimeout()
+{
+	Ec21Emulator module(SerialModule);
+	WioLTE wio;
+
+	CHECK(TestStart(wio));
+	module.SetOpenResult(-1);	// Never reported.
+	unsigned long start = millis();
+	CHECK(wio.SocketOpen("example.com", 80, WIO_TCP) == -1);
+	CHECK(wio.GetLastError() == WioLTE::E_TIMEOUT);
+	CHECK(millis() - start >= 150000);
+}
+
+static void TestOpenClosedByPeer()
+{
+	Ec21Emulator module(SerialModule);
+	WioLTE wio;
+
+	CHECK(TestStart(wio));
+	module.SetOpenLatency(1000);
+	module.Schedule(200, [&module]() { module.CloseSocketByPeer(0); });
+	CHECK(wio.SocketOpen("example.com", 80, WIO_TCP) == -1);
+	CHECK(!module.IsSocketUsed(0));
+
+	// The id is free again.
+	CHECK(wio.SocketOpen("example.com", 80, WIO_TCP) == 0);
+
+	// A late URC for a free id does not take it.
+	module.SendUrc("+QIURC: \"closed\",1");
+	CHECK(wio.GetReceivedSignalStrength() != INT_MIN);
+	CHECK(wio.SocketOpen("example.com", 80, WIO_TCP) == 1);
+}
+
+static void TestOpenStatistics()
+{
+	Ec21Emulator module(SerialModule);
+	WioLTE wio;
+	AtStatistics statistics;
+
+	CHECK(TestStart(wio));
+	wio.GetStatistics(&statistics, true);
+	CHECK(wio.SocketOpen("example.com", 80, WIO_TCP) == 0);
+	module.SetOpenResult(565);
+	CHECK(wio.SocketOpen("example.com", 80, WIO_TCP) == -1);
+	module.SetOpenResult(-1);
+	CHECK(wio.SocketOpen("example.com", 80, WIO_TCP) == -1);
+	CHECK(wio.PollSocketOpen(1) == -1);
+
+	// The wait for +QIOPEN is accounted apart from the AT+QIOPEN command.
+	wio.GetStatistics(&statistics);
+	const AtStatistics::Entry* entry = statistics.Find("+QIOPEN");
+	CHECK(entry != NULL);
+	if (entry == NULL) return;
+	CHECK(entry->Count == 3);
+	CHECK(entry->ErrorCount == 1);
+	CHECK(entry->TimeoutCount == 1);
+	CHECK(entry->MaxTime >= 150000);
+	CHECK(entry->Buckets[4] == 2);		// <1000 msec., with 300 msec. of OpenLatency.
+	entry = statistics.Find("QIOPEN");
+	CHECK(entry != NULL && entry->Count == 3 && entry->MaxTime < 100);
+}
+
+static void TestOpenAsync()
+{
+	Ec21Emulator module(SerialModule);
+	WioLTE wio;
+
+	CHECK(TestStart(wio));
+	int connectIds[2];
+	connectIds[0] = wio.SocketOpenAsync("example.com", 80, WIO_TCP);
+	connectIds[1] = wio.SocketOpenAsync("example.org", 7, WIO_UDP);
+	CHECK(connectIds[0] == 0 && connectIds[1] == 1);
+	CHECK(wio.PollSocketOpen(connectIds[0]) == 0);
+
+	int results[2] = { 0, 0 };
+	for (int i = 0; i < 100 && (results[0] == 0 || results[1] == 0); i++) {
+		delay(10);
+		for (int j = 0; j < 2; j++) {
+			if (results[j] == 0) results[j] = wio.PollSocketOpen(connectIds[j]);
+		}
+	}
+	CHECK(results[0] == 1 && results[1] == 1);
+}
+
+static void TestPoll()
+{
+	Ec21Emulator module(SerialModule);
+	WioLTE wio;
+	int events[2];
+
+	CHECK(TestStart(wio));
+	int connectIds[2];
+	connectIds[0] = wio.SocketOpen("example.com", 80, WIO_TCP);
+	connectIds[1] = wio.SocketOpen("example.org", 80, WIO_TCP);
+	CHECK(connectIds[0] == 0 && connectIds[1] == 1);
+
+	CHECK(wio.SocketPoll(connectIds, events, 2, 100) == 0);
+
+	module.Schedule(200, [&module]() { module.PushSocketData(1, "data"); });
+	unsigned long start = millis();
+	CHECK(wio.SocketPoll(connectIds, events, 2, 10000) == 1);
+	CHECK(millis() - start < 1000);
+	CHECK(events[0] == 0 && events[1] == WIO_SOCKET_READABLE);
+
+	char data[10];
+	CHECK(wio.SocketReceive(connectIds[1], data, sizeof (data)) == 4);
+	CHECK(wio.SocketPoll(connectIds, events, 2, 0) == 0);	// Drained by a short read.
+
+	module.PushSocketData(1, "0123456789AB");
+	CHECK(wio.SocketPoll(connectIds, events, 2, 1000) == 1);
+	CHECK(wio.SocketReceive(connectIds[1], data, sizeof (data)) == 9);
+	CHECK(wio.SocketPoll(connectIds, events, 2, 0) == 1);	// A full read may have left more.
+	CHECK(events[1] == WIO_SOCKET_READABLE);
+	CHECK(wio.SocketReceive(connectIds[1], data, sizeof (data)) == 3);
+	CHECK(strcmp(data, "9AB") == 0);
+	CHECK(wio.SocketPoll(connectIds, events, 2, 0) == 0);
+
+	module.CloseSocketByPeer(0);
+	CHECK(wio.SocketPoll(connectIds, events, 2, 1000) >= 1);
+	CHECK(events[0] & WIO_SOCKET_CLOSED);
+	CHECK(wio.SocketClose(connectIds[0]));
+}
+
+static void TestPdpDeact()
+{
+	Ec21Emulator module(SerialModule);
+	WioLTE wio;
+	int events[1];
+
+	CHECK(TestStart(wio));
+	int connectId = wio.SocketOpen("example.com", 80, WIO_TCP);
+	CHECK(connectId == 0);
+	module.DeactivateContext();
+	CHECK(wio.SocketPoll(&connectId, events, 1, 1000) == 1);
+	CHECK(events[0] == WIO_SOCKET_CLOSED);
+}
+
+static void TestLargeSend()
+{
+	Ec21Emulator module(SerialModule);
+	WioLTE wio;
+
+	CHECK(TestStart(wio));
+	int connectId = wio.SocketOpen("example.com", 80, WIO_TCP);
+	std::string data;
+	for (int i = 0; i < 4000; i++) data += (char)('a' + i % 26);
+	module.ClearCommands();
+	CHECK(wio.SocketWrite(connectId, (const byte*)data.data(), data.size()) == 4000);
+	CHECK(module.GetSocketSentData(connectId) == data);
+	CHECK(module.CountCommands("AT+QISEND=") == 3);
+
+	int udpId = wio.SocketOpen("example.com", 7, WIO_UDP);
+	CHECK(wio.SocketWrite(udpId, (const byte*)data.data(), 2000) == -1);
+	CHECK(!wio.SocketSend(udpId, (const byte*)data.data(), 2000));
+
+	CHECK(wio.SocketWrite(connectId, (const byte*)data.data(), -1) == -1);
+	CHECK(!wio.SocketSend(connectId, (const byte*)data.data(), -1));
+}
+
+static void TestSendWindow()
+{
+	Ec21Emulator module(SerialModule);
+	WioLTE wio;
+	int sentSize;
+	int ackedSize;
+	int unackedSize;
+
+	CHECK(TestStart(wio));
+	int connectId = wio.SocketOpen("example.com", 80, WIO_TCP);
+	std::string data(6000, 'x');
+	module.SetAckDelay(1000);
+	wio.SetSocketSendWindow(3000);
+	CHECK(wio.SocketWrite(connectId, (const byte*)data.data(), data.size()) == 6000);
+	CHECK(module.GetSocketSentData(connectId).size() == 6000);
+	CHECK(module.CountCommands("AT+QISEND=0,0") >= 1);
+
+	CHECK(wio.GetSocketSendState(connectId, &sentSize, &ackedSize, &unackedSize));
+	CHECK(sentSize == 6000 && unackedSize <= 3000 + 1460);
+}
+
+static void TestSendWindowSlowPeer()
+{
+	Ec21Emulator module(SerialModule);
+	WioLTE wio;
+
+	CHECK(TestStart(wio));
+	int connectId = wio.SocketOpen("example.com", 80, WIO_TCP);
+	std::string data(1460, 'x');
+	wio.SetSocketSendWindow(1460);
+
+	// The last write waits 85 s for both acknowledgements, but never 60 s without one.
+	module.SetAckDelay(30000);
+	CHECK(wio.SocketWrite(connectId, (const byte*)data.data(), 700) == 700);
+	module.SetAckDelay(85000);
+	CHECK(wio.SocketWrite(connectId, (const byte*)data.data(), 700) == 700);
+	unsigned long start = millis();
+	CHECK(wio.SocketWrite(connectId, (const byte*)data.data(), 1460) == 1460);
+	CHECK(millis() - start >= 80000);
+
+	// No acknowledgement at all still times out.
+	delay(90000);
+	module.SetAckDelay(1000000);
+	CHECK(wio.SocketWrite(connectId, (const byte*)data.data(), 1460) == 1460);
+	start = millis();
+	CHECK(wio.SocketWrite(connectId, (const byte*)data.data(), 1460) == 0);
+	CHECK(wio.GetLastError() == WioLTE::E_TIMEOUT);
+	CHECK(millis() - start < 70000);
+}
+
+static void TestClient()
+{
+	Ec21Emulator module(SerialModule);
+	WioLTE wio;
+	WioLTEClient client(&wio);
+
+	CHECK(TestStart(wio));
+	CHECK(client.connect("example.com", 80) == 1);
+	CHECK(client.connected());
+	CHECK(client.write((const uint8_t*)"ping", 4) == 4);
+	CHECK(module.GetSocketSentData(0) == "ping");
+	module.PushSocketData(0, "pong");
+	delay(10);
+	CHECK(client.available() == 4);
+	CHECK(client.read() == 'p');
+	client.stop();
+	CHECK(!module.IsSocketUsed(0));
+}
+
+int main()
+{
+	TestRun("OpenSendReceiveClose", TestOpenSendReceiveClose);
+	TestRun("NoAllocation", TestNoAllocation);
+	TestRun("OpenFailure", TestOpenFailure);
+	TestRun("OpenTimeout", TestOpenTimeout);
+	TestRun("OpenClosedByPeer", TestOpenClosedByPeer);
+	TestRun("OpenStatistics", TestOpenStatistics);
+	TestRun("OpenAsync", TestOpenAsync);
+	TestRun("Poll", TestPoll);
+	TestRun("PdpDeact", TestPdpDeact);
+	TestRun("LargeSend", TestLargeSend);
+	TestRun("SendWindow", TestSendWindow);
+	TestRun("SendWindowSlowPeer", TestSendWindowSlowPeer);
+	TestRun("Client", TestClient);
+
+	return TestResult();
+}
@@ -0,0 +1,99 @@
+#include "Test.h"
+#include "../TranscriptPlayer.h"
+#include <string.h>
+#include <limits.h>
+
+struct SessionResult {
+	int RevisionLength;
+	int ConnectId;
+	unsigned long OpenTime;
+	bool Sent;
+	int ReceivedSize;
+	char Received[100];
+	bool Closed;
+};
+
+static void RunSession(WioLTE& wio, SessionResult* result)
+{
+	char revision[100];
+
+	memset(result, 0, sizeof (*result));
+	if (!TestStart(wio)) return;
+	result->RevisionLength = wio.GetRevision(revision, sizeof (revision));
+	unsigned long start = millis();
+	result->ConnectId = wio.SocketOpen("example.com", 80, WIO_TCP);
+	result->OpenTime = millis() - start;
+	result->Sent = wio.SocketSend(result->ConnectId, "hello");
+	result->ReceivedSize = wio.SocketReceive(result->ConnectId, result->Received, sizeof (result->Received), 5000);
+	result->Closed = wio.SocketClose(result->ConnectId);
+}
+
+static void TestReplay()
+{
+	std::vector<uint8_t> transcript;
+	SessionResult recorded;
+	SessionResult replayed;
+
+	{
+		Ec21Emulator module(SerialModule);
+		WioLTE wio;
+		wio.SetTranscriptFunction([&transcript](const byte* data, int dataSize) { transcript.insert(transcript.end(), data, data + dataSize); });
+		module.SetOpenLatency(20000);	// A slow +QIOPEN from the field.
+		module.SetCommandHook([&module](const std::string& command) {
+			if (command.compare(0, 10, "AT+QISEND=") == 0) module.Schedule(1500, [&module]() { module.PushSocketData(0, "world"); });
+			return false;
+		});
+		RunSession(wio, &recorded);
+	}
+	CHECK(recorded.ConnectId == 0 && recorded.Sent && recorded.ReceivedSize == 5 && recorded.Closed);
+	CHECK(recorded.OpenTime >= 20000);
+
+	{
+		TranscriptPlayer player(SerialModule, transcript);
+		WioLTE wio;
+		CHECK(player.IsValid());
+		RunSession(wio, &replayed);
+		CHECK(player.IsFinished());
+		CHECK(player.GetMismatchNum() == 0);
+	}
+	CHECK(replayed.RevisionLength == recorded.RevisionLength);
+	CHECK(replayed.ConnectId == recorded.ConnectId);
+	CHECK(replayed.OpenTime >= 20000 && replayed.OpenTime <= recorded.OpenTime + 10);
+	CHECK(replayed.Sent && replayed.ReceivedSize == 5 && strcmp(replayed.Received, "world") == 0);
+	CHECK(replayed.Closed);
+}
+
+static void TestReplayDivergence()
+{
+	std::vector<uint8_t> transcript;
+
+	{
+		Ec21Emulator module(SerialModule);
+		WioLTE wio;
+		wio.SetTranscriptFunction([&transcript](const byte* data, int dataSize) { transcript.insert(transcript.end(), data, data + dataSize); });
+		CHECK(TestStart(wio, false));
+		CHECK(wio.GetReceivedSignalStrength() != INT_MIN);
+	}
+
+	// A library that issues other commands than the recorded ones is reported.
+	{
+		TranscriptPlayer player(SerialModule, transcript);
+		WioLTE wio;
+		struct tm now;
+		CHECK(TestStart(wio, false));
+		wio.GetTime(&now);
+		CHECK(player.GetMismatchNum() >= 1);
+	}
+
+	transcript.pop_back();
+	TranscriptPlayer player(SerialModule, transcript);
+	CHECK(!player.IsValid());
+}
+
+int main()
+{
+	TestRun("Replay", TestReplay);
+	TestRun("ReplayDivergence", TestReplayDivergence);
+
+	return TestResult();
+}
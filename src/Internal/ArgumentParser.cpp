@@ -1,61 +1,121 @@
 #include "../WioLTEConfig.h"
 #include "ArgumentParser.h"
 #include <string.h>
+#include <stdlib.h>
 
-ArgumentParser::ArgumentParser()
+#define NUMBER_MAX_LENGTH	(31)
+
+static int HexToInt(char c)
 {
+	if ('0' <= c && c <= '9') return c - '0';
+	if ('A' <= c && c <= 'F') return c - 'A' + 10;
+	if ('a' <= c && c <= 'f') return c - 'a' + 10;
+	return -1;
 }
 
-void ArgumentParser::Parse(const char* str)
+ArgumentParser::ArgumentParser() :
+	_ArgumentNum(0)
 {
-	_Arguments.clear();
+}
+
+bool ArgumentParser::Parse(const char* str)
+{
+	return Parse(str, strlen(str));
+}
 
-	// Search comma position.
-	std::vector<const char*> commaList;
+bool ArgumentParser::Parse(const char* str, int length)
+{
+	_ArgumentNum = 0;
+
+	const char* end = str + length;
+	const char* begin = str;
 	bool inString = false;
-	for (const char* ptr = str; *ptr != '\0'; ptr++) {
-		if (!inString) {
-			switch (*ptr) {
-			case ',':
-				commaList.push_back(ptr);
-				break;
-			case '"':
-				inString = true;
-				break;
-			}
-		}
-		else {
-			switch (*ptr) {
-			case '"':
-				inString = false;
-				break;
-			}
+	for (const char* ptr = str; ; ptr++) {
+		if (ptr < end && (inString || *ptr != ',')) {
+			if (*ptr == '"') inString = !inString;
+			continue;
 		}
-	}
 
-	// Build arguments.
-	_Arguments.resize(commaList.size() + 1);
-	for (int i = 0; i < (int)_Arguments.size(); i++) {
-		const char* begin = i == 0 ? str : commaList[i - 1] + 1;
-		const char* end = i < (int)commaList.size() ? commaList[i] : str + strlen(str);
+		if (_ArgumentNum >= ARGUMENT_MAX) return false;
 
-		if (end - begin >= 2 && *begin == '"' && *(end - 1) == '"') {
+		const char* argumentEnd = ptr;
+		if (argumentEnd - begin >= 2 && *begin == '"' && *(argumentEnd - 1) == '"') {
 			begin++;
-			end--;
+			argumentEnd--;
 		}
+		_Arguments[_ArgumentNum].Ptr = begin;
+		_Arguments[_ArgumentNum].Length = argumentEnd - begin;
+		_ArgumentNum++;
 
-		_Arguments[i].resize(end - begin + 1);
-		memcpy(&_Arguments[i][0], begin, end - begin);
-		_Arguments[i][end - begin] = '\0';
+		if (ptr >= end) break;
+		begin = ptr + 1;
 	}
+
+	return true;
 }
 
 int ArgumentParser::Size() const
 {
-	return _Arguments.size();
+	return _ArgumentNum;
+}
+
+const char* ArgumentParser::Pointer(int index) const
+{
+	return _Arguments[index].Ptr;
+}
+
+int ArgumentParser::Length(int index) const
+{
+	return _Arguments[index].Length;
 }
 
-const char* ArgumentParser::operator[](int index) const
+int ArgumentParser::AsInt(int index) const
 {
-	return &_Arguments[index][0];
+	const char* ptr = _Arguments[index].Ptr;
+	const char* end = ptr + _Arguments[index].Length;
+
+	while (ptr < end && *ptr == ' ') ptr++;
+	bool negative = false;
+	if (ptr < end && (*ptr == '-' || *ptr == '+')) negative = *ptr++ == '-';
+
+	int value = 0;
+	for (; ptr < end && '0' <= *ptr && *ptr <= '9'; ptr++) value = value * 10 + (*ptr - '0');
+
+	return negative ? -value : value;
+}
+
+double ArgumentParser::AsDouble(int index) const
+{
+	char str[NUMBER_MAX_LENGTH + 1];
+	int length = _Arguments[index].Length;
+	if (length > NUMBER_MAX_LENGTH) length = NUMBER_MAX_LENGTH;
+	memcpy(str, _Arguments[index].Ptr, length);
+	str[length] = '\0';
+
+	return atof(str);
+}
+
+int ArgumentParser::Unquote(int index, char* str, int strSize) const
+{
+	const char* ptr = _Arguments[index].Ptr;
+	const char* end = ptr + _Arguments[index].Length;
+
+	int length = 0;
+	while (ptr < end) {
+		if (length + 1 >= strSize) return -1;
+
+		int high;
+		int low;
+		if (*ptr == '\\' && end - ptr >= 3 && (high = HexToInt(ptr[1])) >= 0 && (low = HexToInt(ptr[2])) >= 0) {
+			str[length++] = (char)(high * 16 + low);
+			ptr += 3;
+		}
+		else {
+			str[length++] = *ptr++;
+		}
+	}
+	if (strSize < 1) return -1;
+	str[length] = '\0';
+
+	return length;
 }
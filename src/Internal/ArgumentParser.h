@@ -1,16 +1,31 @@
 #pragma once
 
-#include <vector>
-
+// Splits "a,\"b,c\",d" into views over the original string. Nothing is copied or allocated.
+// Surrounding quotes are excluded from a view; Unquote() also decodes \hh escapes.
 class ArgumentParser
 {
+public:
+	static const int ARGUMENT_MAX = 16;
+
 private:
-	std::vector< std::vector<char> > _Arguments;
+	struct Argument {
+		const char* Ptr;
+		int Length;
+	};
+
+	Argument _Arguments[ARGUMENT_MAX];
+	int _ArgumentNum;
 
 public:
 	ArgumentParser();
-	void Parse(const char* str);
+	bool Parse(const char* str);
+	bool Parse(const char* str, int length);	// false if there are more than ARGUMENT_MAX arguments.
 	int Size() const;
-	const char* operator[](int index) const;
+
+	const char* Pointer(int index) const;		// Not null-terminated.
+	int Length(int index) const;
+	int AsInt(int index) const;
+	double AsDouble(int index) const;
+	int Unquote(int index, char* str, int strSize) const;	// Length, or -1 if str is too small.
 
 };
@@ -0,0 +1,96 @@
+#pragma once
+
+#include "AtPattern.h"
+#include <string>
+#include <stdlib.h>
+#include <string.h>
+
+// String field, a view into the response line without surrounding quotes.
+struct AtString {
+	const char* Ptr;
+	int Length;
+};
+
+// Field types and how they appear in a response. AtPattern matches these forms without slre.
+inline const char* AtFieldPattern(const int*) { return AT_PATTERN_INT; }
+inline const char* AtFieldPattern(const double*) { return AT_PATTERN_DECIMAL; }
+inline const char* AtFieldPattern(const AtString*) { return AT_PATTERN_STRING; }
+
+inline void AtFieldDecode(const slre_cap& capture, int* value) { *value = atoi(capture.ptr); }
+inline void AtFieldDecode(const slre_cap& capture, double* value) { *value = atof(capture.ptr); }
+inline void AtFieldDecode(const slre_cap& capture, AtString* value)
+{
+	bool quoted = capture.len >= 2 && capture.ptr[0] == '"';
+	value->Ptr = quoted ? &capture.ptr[1] : capture.ptr;
+	value->Length = quoted ? capture.len - 2 : capture.len;
+}
+
+// Keeps field pointers out of template argument deduction, so that NULL can be passed.
+template<typename T>
+struct AtFieldPointer {
+	typedef T* Type;
+};
+
+// Descriptor of a response such as "+CREG: <n>,<stat>[,...]".
+//   static const AtFields<int, int> FIELDS_CREG("+CREG: ");
+// The line is matched only if it has the prefix and every field in the declared type, so other lines (URCs) are left alone.
+template<typename... Types>
+class AtFields
+{
+public:
+	static const int CAPTURE_NUM = sizeof...(Types) + 1;	// Fields and the ignored rest.
+
+private:
+	std::string _PatternString;
+	AtPattern _Pattern;
+
+	static const char* BuildPattern(std::string* patternString, const char* prefix)
+	{
+		*patternString = "^";
+		for (const char* ptr = prefix; *ptr != '\0'; ptr++) {
+			if (strchr("\\^$.[]|()?*+", *ptr) != NULL) *patternString += '\\';
+			*patternString += *ptr;
+		}
+		const char* fieldPatterns[] = { AtFieldPattern((const Types*)NULL)... };
+		for (int i = 0; i < (int)sizeof...(Types); i++) {
+			if (i >= 1) *patternString += ',';
+			*patternString += fieldPatterns[i];
+		}
+		*patternString += AT_PATTERN_REST "$";
+
+		return patternString->c_str();
+	}
+
+	static void DecodeFields(const slre_cap*)
+	{
+	}
+
+	template<typename T, typename... Rest>
+	static void DecodeFields(const slre_cap* captures, T* value, Rest*... rest)
+	{
+		if (value != NULL) AtFieldDecode(captures[0], value);
+		DecodeFields(&captures[1], rest...);
+	}
+
+public:
+	AtFields(const char* prefix) :
+		_Pattern(BuildPattern(&_PatternString, prefix))
+	{
+	}
+
+	const AtPattern& GetPattern() const
+	{
+		return _Pattern;
+	}
+
+	// captures as filled by a match of GetPattern(). NULL skips a field.
+	void Decode(const slre_cap* captures, typename AtFieldPointer<Types>::Type... values) const
+	{
+		DecodeFields(captures, values...);
+	}
+
+private:
+	AtFields(const AtFields&);
+	AtFields& operator=(const AtFields&);
+
+};
@@ -0,0 +1,238 @@
+#include "../WioLTEConfig.h"
+#include "AtPattern.h"
+
+#include <string.h>
+
+static const char* const FIELD_FORMS[] = { AT_PATTERN_INT, AT_PATTERN_DECIMAL, AT_PATTERN_STRING };
+
+static bool IsMetaChar(char c)
+{
+	return c != '\0' && strchr("\\^$.[]|()?*+", c) != NULL;
+}
+
+static bool IsDigit(char c)
+{
+	return '0' <= c && c <= '9';
+}
+
+AtPattern::AtPattern(const char* pattern) :
+	_Pattern(pattern),
+	_EndAnchor(false),
+	_Capture(CAPTURE_NONE),
+	_AlternativeNum(0),
+	_FieldNum(0)
+{
+	_Compiled = Compile();
+	if (!_Compiled) {
+		int length = strlen(pattern);
+		_EndAnchor = length >= 1 && pattern[length - 1] == '$';
+	}
+}
+
+const char* AtPattern::ParseAlternative(const char* ptr, Alternative* alternative)
+{
+	alternative->Literal = ptr;
+	alternative->LiteralLength = 0;
+	alternative->AnyTail = false;
+
+	while (*ptr != '\0') {
+		if (*ptr == '\\') {
+			if (!IsMetaChar(ptr[1])) return NULL;
+			ptr += 2;
+		}
+		else if (IsMetaChar(*ptr)) {
+			break;
+		}
+		else {
+			ptr++;
+		}
+		alternative->LiteralLength++;
+	}
+
+	if (ptr[0] == '.' && ptr[1] == '*') {
+		alternative->AnyTail = true;
+		ptr += 2;
+	}
+
+	return ptr;
+}
+
+const char* AtPattern::ParseFields(const char* ptr)
+{
+	while (true) {
+		int type = FIELD_TYPE_NUM;
+		for (int i = 0; i < FIELD_TYPE_NUM; i++) {
+			if (strncmp(ptr, FIELD_FORMS[i], strlen(FIELD_FORMS[i])) == 0) type = i;
+		}
+		if (type >= FIELD_TYPE_NUM || _FieldNum >= FIELD_MAX) return NULL;
+		_Fields[_FieldNum++] = type;
+		ptr += strlen(FIELD_FORMS[type]);
+
+		if (*ptr != ',') break;
+		ptr++;
+	}
+	if (strncmp(ptr, AT_PATTERN_REST, strlen(AT_PATTERN_REST)) != 0) return NULL;
+
+	return ptr + strlen(AT_PATTERN_REST);
+}
+
+bool AtPattern::Compile()
+{
+	const char* ptr = _Pattern;
+	if (*ptr++ != '^') return false;
+
+	if (ptr[0] == '(' && strncmp(ptr, "(.*)", 4) != 0) {
+		// ^(alt|alt|...)
+		_Capture = CAPTURE_WHOLE;
+		ptr++;
+		while (true) {
+			if (_AlternativeNum >= ALTERNATIVE_MAX) return false;
+			ptr = ParseAlternative(ptr, &_Alternatives[_AlternativeNum++]);
+			if (ptr == NULL) return false;
+			if (*ptr == ')') break;
+			if (*ptr != '|') return false;
+			ptr++;
+		}
+		ptr++;
+	}
+	else {
+		// ^literal ^literal.* ^literal(.*) ^literal<field>,...(,.*)?
+		ptr = ParseAlternative(ptr, &_Alternatives[_AlternativeNum++]);
+		if (ptr == NULL) return false;
+		if (!_Alternatives[0].AnyTail && strncmp(ptr, "(.*)", 4) == 0) {
+			_Capture = CAPTURE_REST;
+			_Alternatives[0].AnyTail = true;
+			ptr += 4;
+		}
+		else if (!_Alternatives[0].AnyTail && *ptr == '(') {
+			_Capture = CAPTURE_FIELDS;
+			_Alternatives[0].AnyTail = true;
+			ptr = ParseFields(ptr);
+			if (ptr == NULL) return false;
+		}
+	}
+
+	if (*ptr == '$') {
+		_EndAnchor = true;
+		ptr++;
+	}
+	if (_Capture == CAPTURE_FIELDS && !_EndAnchor) return false;
+
+	return *ptr == '\0';
+}
+
+bool AtPattern::MatchAlternative(const Alternative& alternative, const char* response, int responseLength) const
+{
+	if (responseLength < alternative.LiteralLength) return false;
+	if (_EndAnchor && !alternative.AnyTail && responseLength != alternative.LiteralLength) return false;
+
+	const char* literal = alternative.Literal;
+	for (int i = 0; i < alternative.LiteralLength; i++) {
+		if (*literal == '\\') literal++;
+		if (*literal++ != response[i]) return false;
+	}
+
+	return true;
+}
+
+bool AtPattern::MatchFields(const char* str, int length, slre_cap* captures, int captureNum) const
+{
+	// As slre would: a quoted string must be followed by a separator or the end. Failing that, it is read up to its first separator if there is one inside the quotes.
+	const char* end = &str[length];
+	for (int i = 0; i < _FieldNum; i++) {
+		if (i >= 1) {
+			if (str >= end || *str != ',') return false;
+			str++;
+		}
+
+		const char* fieldEnd = str;
+		if (_Fields[i] == FIELD_STRING) {
+			const char* quote = str < end && *str == '"' ? (const char*)memchr(&str[1], '"', end - str - 1) : NULL;
+			while (fieldEnd < end && *fieldEnd != ',') fieldEnd++;
+			if (quote != NULL && (&quote[1] >= end || quote[1] == ',')) {
+				fieldEnd = &quote[1];
+			}
+			else if (quote != NULL && fieldEnd > quote) {
+				return false;
+			}
+		}
+		else {
+			if (fieldEnd < end && *fieldEnd == '-') fieldEnd++;
+			const char* digits = fieldEnd;
+			while (fieldEnd < end && (IsDigit(*fieldEnd) || (_Fields[i] == FIELD_DECIMAL && *fieldEnd == '.'))) fieldEnd++;
+			if (fieldEnd <= digits) return false;
+		}
+
+		if (i < captureNum) {
+			captures[i].ptr = str;
+			captures[i].len = fieldEnd - str;
+		}
+		str = fieldEnd;
+	}
+	if (str < end && *str != ',') return false;
+	if (_FieldNum < captureNum) {
+		captures[_FieldNum].ptr = str;
+		captures[_FieldNum].len = end - str;
+	}
+
+	return true;
+}
+
+const char* AtPattern::GetString() const
+{
+	return _Pattern;
+}
+
+bool AtPattern::IsCompiled() const
+{
+	return _Compiled;
+}
+
+bool AtPattern::HasEndAnchor() const
+{
+	return _EndAnchor;
+}
+
+int AtPattern::GetPromptDecisionLength() const
+{
+	if (!_Compiled) return -1;
+
+	// A prompt without end anchor either matches within its longest literal or never does.
+	int length = 1;
+	for (int i = 0; i < _AlternativeNum; i++) {
+		if (_Alternatives[i].LiteralLength > length) length = _Alternatives[i].LiteralLength;
+	}
+
+	return length;
+}
+
+bool AtPattern::Match(const char* response, int responseLength, slre_cap* captures, int captureNum) const
+{
+	if (!_Compiled) return slre_match(_Pattern, response, responseLength, captureNum >= 1 ? captures : NULL, captureNum, 0) >= 1;
+	if (responseLength <= 0) return false;	// Same as slre, an empty line never matches.
+
+	for (int i = 0; i < _AlternativeNum; i++) {
+		const Alternative& alternative = _Alternatives[i];
+		if (!MatchAlternative(alternative, response, responseLength)) continue;
+		if (_Capture == CAPTURE_FIELDS) return MatchFields(&response[alternative.LiteralLength], responseLength - alternative.LiteralLength, captures, captureNum);
+
+		if (captureNum >= 1) {
+			switch (_Capture) {
+			case CAPTURE_WHOLE:
+				captures[0].ptr = response;
+				captures[0].len = alternative.AnyTail ? responseLength : alternative.LiteralLength;
+				break;
+			case CAPTURE_REST:
+				captures[0].ptr = &response[alternative.LiteralLength];
+				captures[0].len = responseLength - alternative.LiteralLength;
+				break;
+			default:
+				break;
+			}
+		}
+
+		return true;
+	}
+
+	return false;
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include "slre.901d42c/slre.h"
+
+// Field forms, as written by AtFields.
+#define AT_PATTERN_INT		"(-?[0-9]+)"
+#define AT_PATTERN_DECIMAL	"(-?[0-9\\.]+)"
+// slre lets a negated set match the terminating NUL, so it is excluded explicitly.
+#define AT_PATTERN_STRING	"(\"[^\"\\x00]*\"|[^,\\x00]*)"
+#define AT_PATTERN_REST		"(,.*)?"
+
+// Response pattern parsed once at construction.
+// The forms used by the driver are matched directly:
+//   ^literal$  ^literal.*$  ^literal(.*)$  ^(alt|alt.*|...)$  ^literal (prompt)
+//   ^literal<field>,<field>,...(,.*)?$ with the field forms above
+// Anything else, including patterns with several capture groups, is handed to slre as before.
+// The pattern string must outlive this object.
+class AtPattern
+{
+private:
+	static const int ALTERNATIVE_MAX = 4;
+	static const int FIELD_MAX = 10;
+
+	enum CaptureType {
+		CAPTURE_NONE,
+		CAPTURE_WHOLE,		// ^(...)$
+		CAPTURE_REST,		// ^literal(.*)$
+		CAPTURE_FIELDS,		// ^literal<field>,...(,.*)?$
+	};
+
+	enum FieldType {
+		FIELD_INT,
+		FIELD_DECIMAL,
+		FIELD_STRING,
+		FIELD_TYPE_NUM,
+	};
+
+	struct Alternative {
+		const char* Literal;	// Escaped, as written in the pattern.
+		int LiteralLength;		// Unescaped length.
+		bool AnyTail;			// Followed by ".*".
+	};
+
+	const char* _Pattern;
+	bool _Compiled;
+	bool _EndAnchor;
+	CaptureType _Capture;
+	Alternative _Alternatives[ALTERNATIVE_MAX];
+	int _AlternativeNum;
+	unsigned char _Fields[FIELD_MAX];	// FieldType
+	int _FieldNum;
+
+	bool Compile();
+	const char* ParseAlternative(const char* ptr, Alternative* alternative);
+	const char* ParseFields(const char* ptr);
+	bool MatchAlternative(const Alternative& alternative, const char* response, int responseLength) const;
+	bool MatchFields(const char* str, int length, slre_cap* captures, int captureNum) const;
+
+public:
+	AtPattern(const char* pattern);
+
+	const char* GetString() const;
+	bool IsCompiled() const;	// false if matched by slre.
+	bool HasEndAnchor() const;
+	int GetPromptDecisionLength() const;
+	bool Match(const char* response, int responseLength, slre_cap* captures, int captureNum) const;
+
+};
@@ -1,23 +1,46 @@
 #include "../WioLTEConfig.h"
 #include "AtSerial.h"
 
-#include "Debug.h"
-#include "slre.901d42c/slre.h"
+#include "Trace.h"
 #include "../WioLTE.h"
 #include <string.h>
+#include <stdlib.h>
 
 #define READ_BYTE_TIMEOUT	(10)
-#define RESPONSE_MAX_LENGTH	(1024)
 
 #define WRITE_BINARY_WAIT_SIZE	(80)
 
 #define CHAR_CR (0x0d)
 #define CHAR_LF (0x0a)
 
+#define TRANSCRIPT_SEND		(0)
+#define TRANSCRIPT_RECEIVE	(1)
+
+static int EncodeVarint(byte* data, unsigned long value)
+{
+	int size = 0;
+	while (value >= 0x80) {
+		data[size++] = (byte)(value | 0x80);
+		value >>= 7;
+	}
+	data[size++] = (byte)value;
+
+	return size;
+}
+
+static bool IsErrorLine(const char* response)
+{
+	return strcmp(response, "ERROR") == 0 || strncmp(response, "+CME ERROR:", 11) == 0 || strncmp(response, "+CMS ERROR:", 11) == 0;
+}
+
 AtSerial::AtSerial(SerialAPI* serial, WioLTE* wioLTE) :
 	_Serial(serial),
 	_WioLTE(wioLTE),
-	_DoWorkInWaitForAvailable{ nullptr }
+	_DoWorkInWaitForAvailable{ nullptr },
+	_TranscriptFunction{ nullptr },
+	_TranscriptTime(0),
+	_ErrorResponse(false),
+	_ErrorCode(-1)
 {
 }
 
@@ -26,11 +49,39 @@ void AtSerial::SetDoWorkInWaitForAvailableFunction(std::function<void()> func)
 	_DoWorkInWaitForAvailable = func;
 }
 
+void AtSerial::SetTranscriptFunction(std::function<void(const byte*, int)> func)
+{
+	_TranscriptFunction = func;
+	_TranscriptTime = 0;
+}
+
+void AtSerial::Record(bool receive, unsigned long time, const byte* data, int dataSize)
+{
+	if (!_TranscriptFunction || dataSize <= 0) return;
+
+	byte header[1 + 5 + 5];
+	int headerSize = 0;
+	header[headerSize++] = receive ? TRANSCRIPT_RECEIVE : TRANSCRIPT_SEND;
+	headerSize += EncodeVarint(&header[headerSize], dataSize);
+	headerSize += EncodeVarint(&header[headerSize], time - _TranscriptTime);
+	_TranscriptTime = time;
+
+	_TranscriptFunction(header, headerSize);
+	_TranscriptFunction(data, dataSize);
+}
+
+AtStatistics* AtSerial::GetStatistics()
+{
+	return &_Statistics;
+}
+
 bool AtSerial::WaitForAvailable(Stopwatch* sw, unsigned long timeout) const
 {
 	while (!_Serial->Available()) {
 		if (sw != NULL && sw->ElapsedMilliseconds() >= timeout) {
-			DEBUG_PRINTLN("### TIMEOUT ###");
+			if (timeout > 0) {	// Zero is a poll.
+				TRACE(Trace::EVENT_TIMEOUT, 0, timeout);
+			}
 			return false;
 		}
 		if (_DoWorkInWaitForAvailable) _DoWorkInWaitForAvailable();
@@ -41,119 +92,196 @@ bool AtSerial::WaitForAvailable(Stopwatch* sw, unsigned long timeout) const
 
 void AtSerial::WriteBinary(const byte* data, int dataSize)
 {
-	DEBUG_PRINTLN("<- (binary)");
+	TRACE(Trace::EVENT_BINARY_WRITE, 0, dataSize);
 
-	for (int i = 0; i < dataSize; i++) {
-		_Serial->Write(data[i]);
+	Record(false, millis(), data, dataSize);
 
-		if (i % WRITE_BINARY_WAIT_SIZE == WRITE_BINARY_WAIT_SIZE - 1)
-		{
-			_Serial->Flush();
-			delay(1);
-		}
+	// Each chunk is handed to the UART in one call and drained before the next, so the modem is paced by the line itself rather than by fixed sleeps.
+	for (int i = 0; i < dataSize; i += WRITE_BINARY_WAIT_SIZE) {
+		int chunkSize = dataSize - i < WRITE_BINARY_WAIT_SIZE ? dataSize - i : WRITE_BINARY_WAIT_SIZE;
+		_Serial->Write(&data[i], chunkSize);
+		_Serial->Flush();
 	}
 }
 
 bool AtSerial::ReadBinary(byte* data, int dataSize, unsigned long timeout)
 {
+	// Everything already received is copied at once; timeout applies to each gap in the stream.
 	Stopwatch sw;
-	for (int i = 0; i < dataSize; i++) {
+	int readSize = 0;
+	while (readSize < dataSize) {
 		sw.Restart();
-		if (!WaitForAvailable(&sw, timeout)) return false;
+		if (!WaitForAvailable(&sw, timeout)) {
+			_Statistics.Response(millis(), true);
+			return false;
+		}
 
-		data[i] = _Serial->Read();
+		int size = _Serial->Read(&data[readSize], dataSize - readSize);
+		Record(true, millis(), &data[readSize], size);
+		readSize += size;
 	}
 
-	DEBUG_PRINTLN("-> (binary)");
+	_Statistics.Response(millis(), false);
+
+	TRACE(Trace::EVENT_BINARY_READ, 0, dataSize);
 
 	return true;
 }
 
 void AtSerial::WriteCommand(const char* command)
 {
-	DEBUG_PRINT("<- ");
-	DEBUG_PRINTLN(command);
+	TRACE_STRING(Trace::EVENT_COMMAND, strncmp(command, "AT+", 3) == 0 ? &command[3] : command, strlen(command));
 
-	while (*command != '\0') {
-		_Serial->Write((byte)*command);
-		command++;
-	}
+	unsigned long time = millis();
+	_Statistics.Begin(command, time);
+	_Serial->Write((const byte*)command, strlen(command));
 	_Serial->Write((byte)CHAR_CR);
+	Record(false, time, (const byte*)command, strlen(command));
+	Record(false, time, (const byte*)"\r", 1);
 }
 
-bool AtSerial::ReadResponseInternal(const char* pattern, unsigned long timeout, std::string* response, int responseMaxLength)
+bool AtSerial::ReadResponseInternal(const AtPattern* patterns, int patternNum, unsigned long timeout, char* response, int responseSize, int* responseLength)
 {
-	DEBUG_PRINT("-> ");
-
-	response->clear();
+	// A prompt such as "^> " is decided within its first few bytes, so it is not rescanned for the rest of the line.
+	int promptLength = 0;
+	for (int i = 0; i < patternNum; i++) {
+		if (patterns[i].HasEndAnchor()) continue;
+		int decisionLength = patterns[i].GetPromptDecisionLength();
+		if (decisionLength < 0) {
+			promptLength = -1;
+			break;
+		}
+		if (decisionLength > promptLength) promptLength = decisionLength;
+	}
+	bool lastIsCr = false;
+	int length = 0;
+	unsigned long lineTime = 0;
 
 	Stopwatch sw;
 	while (true) {
-		if (response->size() >= (size_t)(responseMaxLength + 2)) {
-			DEBUG_PRINTLN("### OVERFLOW ###");
+		if (length >= responseSize - 1) {
+			TRACE(Trace::EVENT_OVERFLOW, 0, length);
+			Record(true, lineTime, (const byte*)response, length);
 			return false;
 		}
 
 		sw.Restart();
 		if (!WaitForAvailable(&sw, timeout)) {
-			DEBUG_PRINTLN("### TIMEOUT ###");
+			Record(true, lineTime, (const byte*)response, length);
 			return false;
 		}
 
-		response->push_back(_Serial->Read());
+		char c = _Serial->Read();
+		if (length == 0 && _TranscriptFunction) lineTime = millis();
 
-		if (response->size() >= 2 && response->at(response->size() - 2) == CHAR_CR && response->at(response->size() - 1) == CHAR_LF) {
-			response->resize(response->size() - 2);
-			DEBUG_PRINTLN(response->c_str());
+		if (lastIsCr && c == CHAR_LF) {
+			response[length] = c;	// Recorded as received, then replaced with the terminator.
+			Record(true, lineTime, (const byte*)response, length + 1);
+			response[--length] = '\0';
+			*responseLength = length;
+			TRACE_STRING(Trace::EVENT_RESPONSE, response, length);
 			return true;
 		}
+		lastIsCr = c == CHAR_CR;
+		response[length++] = c;
+
+		if (promptLength != 0 && (promptLength < 0 || length <= promptLength)) {
+			response[length] = '\0';
+			for (int i = 0; i < patternNum; i++) {
+				if (patterns[i].HasEndAnchor() || !patterns[i].Match(response, length, NULL, 0)) continue;
 
-		if (pattern != NULL) {
-			if (slre_match(pattern, response->c_str(), response->size(), NULL, 0, 0) >= 1) {
-				DEBUG_PRINTLN(response->c_str());
+				Record(true, lineTime, (const byte*)response, length);
+				*responseLength = length;
+				TRACE_STRING(Trace::EVENT_RESPONSE, response, length);
 				return true;
 			}
 		}
 	}
 }
 
-bool AtSerial::ReadResponse(const char* pattern, unsigned long timeout, std::string* capture)
+bool AtSerial::ReadResponse(const AtPattern& pattern, unsigned long timeout, std::string* capture)
 {
-	const char* internalPattern = NULL;
-	if (pattern[strlen(pattern) - 1] != '$') {
-		internalPattern = pattern;
-	}
+	slre_cap cap;
+	if (!ReadResponse(pattern, timeout, &cap, 1)) return false;
+
+	if (capture != NULL) capture->assign(cap.ptr, cap.len);
+
+	return true;
+}
+
+bool AtSerial::ReadResponse(const AtPattern& pattern, unsigned long timeout, slre_cap* captures, int captureNum)
+{
+	return ReadResponse(&pattern, 1, timeout, captures, captureNum) >= 0;
+}
+
+int AtSerial::ReadResponse(const AtPattern* patterns, int patternNum, unsigned long timeout, slre_cap* captures, int captureNum)
+{
+	_ErrorResponse = false;
 
 	Stopwatch sw;
 	sw.Restart();
 	while (true) {
-		if (!WaitForAvailable(&sw, timeout)) return false;
+		int responseLength;
+		if (!WaitForAvailable(&sw, timeout) || !ReadResponseInternal(patterns, patternNum, READ_BYTE_TIMEOUT, _LineBuffer, sizeof (_LineBuffer), &responseLength)) {
+			_Statistics.Response(millis(), true);
+			return -1;
+		}
+		bool error = IsErrorLine(_LineBuffer);
+		if (error) _Statistics.Error();
 
-		std::string response;
-		if (!ReadResponseInternal(internalPattern, READ_BYTE_TIMEOUT, &response, RESPONSE_MAX_LENGTH)) return false;
+		for (int i = 0; i < patternNum; i++) {
+			for (int j = 0; j < captureNum; j++) {
+				captures[j].ptr = &_LineBuffer[responseLength];
+				captures[j].len = 0;
+			}
+			if (!patterns[i].Match(_LineBuffer, responseLength, captures, captureNum)) continue;
 
-		if (_WioLTE->ReadResponseCallback(response.c_str())) {
-			continue;
+			_Statistics.Response(millis(), false);
+			return i;
 		}
 
-		slre_cap cap;
-		cap.len = 0;
-		if (slre_match(pattern, response.c_str(), response.size(), &cap, 1, 0) >= 1) {
-			if (capture != NULL) {
-				capture->resize(cap.len);
-				memcpy(&(*capture)[0], cap.ptr, cap.len);
-			}
-			return true;
+		if (error) {
+			_Statistics.Response(millis(), false);
+			_ErrorResponse = true;
+			_ErrorCode = _LineBuffer[0] == '+' ? atoi(&_LineBuffer[11]) : -1;
+			return -1;
 		}
+
+		// Lines the caller is not waiting for may be URCs.
+		_WioLTE->ReadResponseCallback(_LineBuffer);
 	}
 }
 
-bool AtSerial::WriteCommandAndReadResponse(const char* command, const char* pattern, unsigned long timeout, std::string* capture)
+bool AtSerial::WriteCommandAndReadResponse(const char* command, const AtPattern& pattern, unsigned long timeout, std::string* capture)
 {
 	WriteCommand(command);
 	return ReadResponse(pattern, timeout, capture);
 }
 
+bool AtSerial::ReadUrc(unsigned long timeout)
+{
+	Stopwatch sw;
+	sw.Restart();
+	if (!WaitForAvailable(&sw, timeout)) return false;
+
+	int responseLength;
+	if (!ReadResponseInternal(NULL, 0, READ_BYTE_TIMEOUT, _LineBuffer, sizeof (_LineBuffer), &responseLength)) return false;
+
+	_WioLTE->ReadResponseCallback(_LineBuffer);
+
+	return true;
+}
+
+bool AtSerial::IsErrorResponse() const
+{
+	return _ErrorResponse;
+}
+
+int AtSerial::GetErrorCode() const
+{
+	return _ErrorCode;
+}
+
 bool AtSerial::ReadResponseQHTTPREAD(char* data, int dataSize, unsigned long timeout)
 {
 	int contentLength = 0;
@@ -161,19 +289,24 @@ bool AtSerial::ReadResponseQHTTPREAD(char* data, int dataSize, unsigned long tim
 	Stopwatch sw;
 	sw.Restart();
 	while (true) {
-		if (!WaitForAvailable(&sw, timeout)) return false;
-
-		std::string response;
-		if (!ReadResponseInternal(NULL, 1000, &response, dataSize - 2 - 1)) return false;
-		if (response == "OK") break;
+		// Lines are read straight into the caller's buffer; a terminating "OK" is overwritten below.
+		int responseLength;
+		if (!WaitForAvailable(&sw, timeout) || !ReadResponseInternal(NULL, 0, 1000, &data[contentLength], dataSize - contentLength, &responseLength)) {
+			_Statistics.Response(millis(), true);
+			return false;
+		}
+		if (strcmp(&data[contentLength], "OK") == 0) break;
 
-		if (contentLength + response.size() + 2 + 1 > (size_t)dataSize) return false;
-		memcpy(&data[contentLength], response.c_str(), response.size());
-		strcpy(&data[contentLength + response.size()], "\r\n");
-		contentLength += response.size() + 2;
+		if (contentLength + responseLength + 2 + 1 > dataSize) {
+			_Statistics.Response(millis(), false);
+			return false;
+		}
+		strcpy(&data[contentLength + responseLength], "\r\n");
+		contentLength += responseLength + 2;
 	}
-	if (contentLength >= 2 && strcmp(&data[contentLength - 2], "\r\n") == 0) contentLength -= 2;
+	if (contentLength >= 2 && strncmp(&data[contentLength - 2], "\r\n", 2) == 0) contentLength -= 2;
 	data[contentLength] = '\0';
+	_Statistics.Response(millis(), false);
 
 	return true;
 }
@@ -2,6 +2,9 @@
 
 #include "SerialAPI.h"
 #include "Stopwatch.h"
+#include "AtPattern.h"
+#include "AtFields.h"
+#include "AtStatistics.h"
 #include <string>
 #include <functional>
 
@@ -9,17 +12,31 @@ class WioLTE;
 
 class AtSerial
 {
+public:
+	static const int RESPONSE_MAX_LENGTH = 1024;
+
 private:
 	SerialAPI* _Serial;
 	WioLTE* _WioLTE;
 	std::function<void()> _DoWorkInWaitForAvailable;
+	std::function<void(const byte*, int)> _TranscriptFunction;
+	unsigned long _TranscriptTime;
+	AtStatistics _Statistics;
+	bool _ErrorResponse;
+	int _ErrorCode;
+	char _LineBuffer[RESPONSE_MAX_LENGTH + 3];	// Line, CR and LF, which is replaced with '\0'.
 
-	bool ReadResponseInternal(const char* pattern, unsigned long timeout, std::string* response, int responseMaxLength);
+	void Record(bool receive, unsigned long time, const byte* data, int dataSize);
+	bool ReadResponseInternal(const AtPattern* patterns, int patternNum, unsigned long timeout, char* response, int responseSize, int* responseLength);
 
 public:
 	AtSerial(SerialAPI* serial, WioLTE* wioLTE);
 
 	void SetDoWorkInWaitForAvailableFunction(std::function<void()> func);
+	// Transcript is a sequence of records: direction (0:send 1:receive), varint length, varint milliseconds since previous record, data.
+	void SetTranscriptFunction(std::function<void(const byte*, int)> func);
+
+	AtStatistics* GetStatistics();
 
 	bool WaitForAvailable(Stopwatch* sw, unsigned long timeout) const;
 
@@ -27,8 +44,29 @@ public:
 	bool ReadBinary(byte* data, int dataSize, unsigned long timeout);
 
 	void WriteCommand(const char* command);
-	bool ReadResponse(const char* pattern, unsigned long timeout, std::string* capture);
-	bool WriteCommandAndReadResponse(const char* command, const char* pattern, unsigned long timeout, std::string* capture);
+	bool ReadResponse(const AtPattern& pattern, unsigned long timeout, std::string* capture);
+	bool ReadResponse(const AtPattern& pattern, unsigned long timeout, slre_cap* captures, int captureNum);	// One view per capture group, pointing into the line buffer until the next read. Unmatched groups are empty.
+	int ReadResponse(const AtPattern* patterns, int patternNum, unsigned long timeout, slre_cap* captures, int captureNum);	// Index of the matched pattern, -1 on failure.
+	template<int N>
+	int ReadResponse(const AtPattern (&patterns)[N], unsigned long timeout, slre_cap* captures, int captureNum)
+	{
+		return ReadResponse(patterns, N, timeout, captures, captureNum);
+	}
+	template<typename... Types>
+	bool ReadResponse(const AtFields<Types...>& fields, unsigned long timeout, typename AtFieldPointer<Types>::Type... values)	// Strings point into the line buffer until the next read.
+	{
+		slre_cap captures[AtFields<Types...>::CAPTURE_NUM];
+		if (!ReadResponse(fields.GetPattern(), timeout, captures, AtFields<Types...>::CAPTURE_NUM)) return false;
+		fields.Decode(captures, values...);
+		return true;
+	}
+	bool WriteCommandAndReadResponse(const char* command, const AtPattern& pattern, unsigned long timeout, std::string* capture);
+
+	bool ReadUrc(unsigned long timeout);
+
+	// A read fails as soon as ERROR, +CME ERROR or +CMS ERROR arrives unless the pattern accepts it.
+	bool IsErrorResponse() const;	// The last failed read ended with an error rather than a timeout.
+	int GetErrorCode() const;		// <err> of +CME ERROR or +CMS ERROR, -1 for ERROR.
 
 	bool ReadResponseQHTTPREAD(char* data, int dataSize, unsigned long timeout);
 
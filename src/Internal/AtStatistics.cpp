@@ -0,0 +1,125 @@
+#include "../WioLTEConfig.h"
+#include "AtStatistics.h"
+
+#include <string.h>
+
+#define OTHER_VERB	"*"
+
+static const unsigned long BUCKET_LIMITS[AtStatistics::BUCKET_NUM - 1] = { 10, 30, 100, 300, 1000, 3000, 10000 };
+
+AtStatistics::AtStatistics()
+{
+	Clear();
+}
+
+void AtStatistics::Clear()
+{
+	_EntryNum = 0;
+	_Pending = false;
+}
+
+AtStatistics::Entry* AtStatistics::GetOrAddEntry(const char* verb)
+{
+	for (int i = 0; i < _EntryNum; i++) {
+		if (strcmp(_Entries[i].Verb, verb) == 0) return &_Entries[i];
+	}
+	if (_EntryNum >= ENTRY_MAX - 1) {
+		if (_EntryNum >= ENTRY_MAX) return &_Entries[ENTRY_MAX - 1];
+		verb = OTHER_VERB;
+	}
+
+	Entry* entry = &_Entries[_EntryNum++];
+	memset(entry, 0, sizeof (*entry));
+	strcpy(entry->Verb, verb);
+
+	return entry;
+}
+
+void AtStatistics::Begin(const char* command, unsigned long time)
+{
+	Commit();
+
+	// "AT+QIOPEN=..." -> "QIOPEN", "AT&W" -> "&W", "AT" -> "AT", "AT+CGREG?;+CEREG?" -> "CGREG"
+	if (strncmp(command, "AT", 2) == 0) command += 2;
+	if (*command == '+') command++;
+	int length = 0;
+	while (length < VERB_MAX_LENGTH && command[length] != '\0' && command[length] != '=' && command[length] != '?' && command[length] != ';') length++;
+	if (length <= 0) {
+		strcpy(_Verb, "AT");
+	}
+	else {
+		memcpy(_Verb, command, length);
+		_Verb[length] = '\0';
+	}
+
+	_Pending = true;
+	_BeginTime = time;
+	_EndTime = time;
+	_Timeout = false;
+	_Error = false;
+}
+
+void AtStatistics::Response(unsigned long time, bool timeout)
+{
+	if (!_Pending) return;
+
+	_EndTime = time;
+	if (timeout) _Timeout = true;
+}
+
+void AtStatistics::Error()
+{
+	if (!_Pending) return;
+
+	_Error = true;
+}
+
+void AtStatistics::Commit()
+{
+	if (!_Pending) return;
+	_Pending = false;
+
+	Record(_Verb, _EndTime - _BeginTime, _Timeout, _Error);
+}
+
+void AtStatistics::Record(const char* verb, unsigned long time, bool timeout, bool error)
+{
+	Entry* entry = GetOrAddEntry(verb);
+	int bucket = 0;
+	while (bucket < BUCKET_NUM - 1 && time >= BUCKET_LIMITS[bucket]) bucket++;
+
+	entry->Count++;
+	if (timeout) entry->TimeoutCount++;
+	if (error) entry->ErrorCount++;
+	entry->TotalTime += time;
+	if (time > entry->MaxTime) entry->MaxTime = time;
+	entry->Buckets[bucket]++;
+}
+
+int AtStatistics::GetEntryNum() const
+{
+	return _EntryNum;
+}
+
+const AtStatistics::Entry* AtStatistics::GetEntry(int index) const
+{
+	if (index < 0 || _EntryNum <= index) return NULL;
+
+	return &_Entries[index];
+}
+
+const AtStatistics::Entry* AtStatistics::Find(const char* verb) const
+{
+	for (int i = 0; i < _EntryNum; i++) {
+		if (strcmp(_Entries[i].Verb, verb) == 0) return &_Entries[i];
+	}
+
+	return NULL;
+}
+
+unsigned long AtStatistics::GetBucketLimit(int bucket)
+{
+	if (bucket < 0 || BUCKET_NUM - 1 <= bucket) return 0;	// 0 means no upper limit.
+
+	return BUCKET_LIMITS[bucket];
+}
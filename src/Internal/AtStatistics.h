@@ -0,0 +1,52 @@
+#pragma once
+
+// Latency, timeout and error counts of AT commands, keyed by command verb ("QIOPEN" for "AT+QIOPEN=...").
+// A command lasts from its write until the last response read for it before the next command. Waits outside any command,
+// such as for a URC or the boot, are not part of it, and are added by Record() under their own name ("+QIOPEN", "RDY").
+class AtStatistics
+{
+public:
+	static const int VERB_MAX_LENGTH = 11;
+	static const int ENTRY_MAX = 24;		// The last entry collects verbs that do not fit, as "*".
+	static const int BUCKET_NUM = 8;		// <10, <30, <100, <300, <1000, <3000, <10000, >=10000 [msec.]
+
+	struct Entry {
+		char Verb[VERB_MAX_LENGTH + 1];
+		unsigned long Count;
+		unsigned long TimeoutCount;
+		unsigned long ErrorCount;
+		unsigned long TotalTime;
+		unsigned long MaxTime;
+		unsigned long Buckets[BUCKET_NUM];
+	};
+
+private:
+	Entry _Entries[ENTRY_MAX];
+	int _EntryNum;
+
+	char _Verb[VERB_MAX_LENGTH + 1];
+	bool _Pending;
+	unsigned long _BeginTime;
+	unsigned long _EndTime;
+	bool _Timeout;
+	bool _Error;
+
+	Entry* GetOrAddEntry(const char* verb);
+
+public:
+	AtStatistics();
+	void Clear();
+
+	void Begin(const char* command, unsigned long time);
+	void Response(unsigned long time, bool timeout);
+	void Error();
+	void Commit();
+	void Record(const char* verb, unsigned long time, bool timeout, bool error);	// A wait outside any command, e.g. "+QIOPEN" for the URC.
+
+	int GetEntryNum() const;
+	const Entry* GetEntry(int index) const;
+	const Entry* Find(const char* verb) const;
+
+	static unsigned long GetBucketLimit(int bucket);
+
+};
@@ -4,13 +4,23 @@ class SerialAPI
 {
 private:
 	HardwareSerial* _Serial;
+	int _Baud;
 
 public:
-	SerialAPI(HardwareSerial* serial) : _Serial(serial) {}
-	void Begin(int baud) { _Serial->begin(baud); }
+	SerialAPI(HardwareSerial* serial) : _Serial(serial), _Baud(0) {}
+	void Begin(int baud) { _Serial->begin(baud); _Baud = baud; }
+	int GetBaud() const { return _Baud; }
 	void Write(byte data) { _Serial->write(data); }
+	void Write(const byte* data, int dataSize) { _Serial->write(data, dataSize); }
 	bool Available() const { return _Serial->available() >= 1 ? true : false; }
 	byte Read() { return _Serial->read(); }
+	int Read(byte* data, int dataSize)
+	{
+		int size = _Serial->available();
+		if (size > dataSize) size = dataSize;
+		for (int i = 0; i < size; i++) data[i] = _Serial->read();
+		return size;
+	}
 	void Flush() { _Serial->flush(); }
 
 };
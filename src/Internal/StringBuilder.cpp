@@ -1,59 +1,70 @@
 #include "../WioLTEConfig.h"
 #include "StringBuilder.h"
 
-#include <stdio.h>
-#include <stdarg.h>
 #include <string.h>
 
-#define STRING_MAX_SIZE		(200)
+StringBuilderBase::StringBuilderBase(char* buffer, int capacity) :
+	_Buffer(buffer),
+	_Capacity(capacity)
+{
+	Clear();
+}
 
-StringBuilder::StringBuilder()
+void StringBuilderBase::Clear()
 {
-	_Buffer.push_back('\0');
+	_Length = 0;
+	_Overflow = false;
+	_Buffer[0] = '\0';
 }
 
-void StringBuilder::Clear()
+int StringBuilderBase::Length() const
 {
-	_Buffer.clear();
-	_Buffer.push_back('\0');
+	return _Length;
 }
 
-int StringBuilder::Length() const
+const char* StringBuilderBase::GetString() const
 {
-	return _Buffer.size() - 1;
+	return _Buffer;
 }
 
-const char* StringBuilder::GetString() const
+bool StringBuilderBase::IsOverflow() const
 {
-	return &_Buffer[0];
+	return _Overflow;
 }
 
-void StringBuilder::Write(const char* str)
+void StringBuilderBase::Write(const char* str)
 {
-	int i = Length();
-	_Buffer.resize(_Buffer.size() + strlen(str));
-	strcpy(&_Buffer[i], str);
+	Write(str, strlen(str));
 }
 
-void StringBuilder::Write(const char* str, int length)
+void StringBuilderBase::Write(const char* str, int length)
 {
-	int i = Length();
-	_Buffer.resize(_Buffer.size() + length);
-	memcpy(&_Buffer[i], str, length);
-	_Buffer[i + length] = '\0';
+	if (length > _Capacity - 1 - _Length) {
+		length = _Capacity - 1 - _Length;
+		_Overflow = true;
+	}
+	memcpy(&_Buffer[_Length], str, length);
+	_Length += length;
+	_Buffer[_Length] = '\0';
 }
 
-bool StringBuilder::WriteFormat(const char* format, ...)
+void StringBuilderBase::WriteInt(long value)
 {
-	va_list arglist;
-	va_start(arglist, format);
-	char str[STRING_MAX_SIZE];
-	int length = vsnprintf(str, sizeof (str), format, arglist);
-	va_end(arglist);
+	char str[sizeof (long) * 3 + 1];
+	char* ptr = &str[sizeof (str)];
+	unsigned long absValue = value < 0 ? 0UL - (unsigned long)value : (unsigned long)value;
+	do {
+		*--ptr = '0' + absValue % 10;
+		absValue /= 10;
+	} while (absValue != 0);
+	if (value < 0) *--ptr = '-';
 
-	if (length < 0 || (int)(sizeof (str) - 1) <= length) return false;
+	Write(ptr, &str[sizeof (str)] - ptr);
+}
 
+void StringBuilderBase::WriteQuoted(const char* str)
+{
+	Write("\"", 1);
 	Write(str);
-
-	return true;
+	Write("\"", 1);
 }
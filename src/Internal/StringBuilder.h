@@ -1,19 +1,42 @@
 #pragma once
 
-#include <vector>
-
-class StringBuilder
+// Builds a string in a buffer owned by the derived StringBuilder<N>.
+// Writes past the capacity are truncated and remembered, so a sequence of writes is checked once with IsOverflow().
+class StringBuilderBase
 {
 private:
-	std::vector<char> _Buffer;
+	char* _Buffer;
+	int _Capacity;
+	int _Length;
+	bool _Overflow;
+
+	StringBuilderBase(const StringBuilderBase&);
+	StringBuilderBase& operator=(const StringBuilderBase&);
+
+protected:
+	StringBuilderBase(char* buffer, int capacity);
 
 public:
-	StringBuilder();
 	void Clear();
 	int Length() const;
 	const char* GetString() const;
+	bool IsOverflow() const;
 	void Write(const char* str);
 	void Write(const char* str, int length);
-	bool WriteFormat(const char* format, ...);
+	void WriteInt(long value);
+	void WriteQuoted(const char* str);
+
+};
+
+template<int N>
+class StringBuilder : public StringBuilderBase
+{
+private:
+	char _Storage[N];
+
+public:
+	StringBuilder() : StringBuilderBase(_Storage, N)
+	{
+	}
 
 };
@@ -0,0 +1,94 @@
+#include "../WioLTEConfig.h"
+#include "Trace.h"
+
+#ifdef WIO_TRACE
+
+#include <stdio.h>
+
+static Trace::Event Events[Trace::EVENT_NUM];
+static unsigned long WriteCount = 0;
+static unsigned long ReadCount = 0;
+static unsigned long LostCount = 0;
+
+static const char* GetEventName(int id)
+{
+	switch (id) {
+	case Trace::EVENT_COMMAND:		return "<-";
+	case Trace::EVENT_RESPONSE:		return "->";
+	case Trace::EVENT_URC:			return "URC";
+	case Trace::EVENT_TIMEOUT:		return "TIMEOUT";
+	case Trace::EVENT_OVERFLOW:		return "OVERFLOW";
+	case Trace::EVENT_BINARY_WRITE:	return "<-BINARY";
+	case Trace::EVENT_BINARY_READ:	return "->BINARY";
+	case Trace::EVENT_ERROR:		return "ERROR";
+	case Trace::EVENT_BAUD_FALLBACK:	return "BAUD";
+	default:						return "?";
+	}
+}
+
+void Trace::Write(int id, int arg0, long arg1)
+{
+	Event* event = &Events[WriteCount % EVENT_NUM];
+	event->Time = micros();
+	event->Id = id;
+	event->Arg0 = arg0;
+	event->Arg1 = arg1;
+
+	WriteCount++;
+	if (WriteCount - ReadCount > (unsigned long)EVENT_NUM) {
+		ReadCount++;
+		LostCount++;
+	}
+}
+
+void Trace::WriteString(int id, const char* str, int length)
+{
+	unsigned long packed = 0;
+	for (int i = 0; i < 4 && i < length; i++) packed |= (unsigned long)(unsigned char)str[i] << (i * 8);
+
+	Write(id, length, packed);
+}
+
+int Trace::Read(Event* events, int eventNum)
+{
+	int readNum = 0;
+	while (readNum < eventNum && ReadCount != WriteCount) {
+		events[readNum++] = Events[ReadCount++ % EVENT_NUM];
+	}
+
+	return readNum;
+}
+
+unsigned long Trace::GetLostNum()
+{
+	return LostCount;
+}
+
+void Trace::Print()
+{
+	Event event;
+	while (Read(&event, 1) >= 1) {
+		char str[64];
+		switch (event.Id) {
+		case EVENT_COMMAND:
+		case EVENT_RESPONSE:
+		case EVENT_URC: {
+			char text[5];
+			int i;
+			for (i = 0; i < 4 && i < event.Arg0; i++) {
+				char c = (char)(event.Arg1 >> (i * 8));
+				text[i] = c >= 0x20 && c < 0x7f ? c : '.';
+			}
+			text[i] = '\0';
+			snprintf(str, sizeof (str), "%10lu %-8s %s (%d)\r\n", event.Time, GetEventName(event.Id), text, event.Arg0);
+			break;
+		}
+		default:
+			snprintf(str, sizeof (str), "%10lu %-8s %d %ld\r\n", event.Time, GetEventName(event.Id), event.Arg0, event.Arg1);
+			break;
+		}
+		SerialUSB.print(str);
+	}
+}
+
+#endif // WIO_TRACE
@@ -0,0 +1,47 @@
+#pragma once
+
+#ifdef WIO_TRACE
+
+#define TRACE(id, arg0, arg1)			Trace::Write((id), (arg0), (arg1))
+#define TRACE_STRING(id, str, length)	Trace::WriteString((id), (str), (length))
+
+#else
+
+#define TRACE(id, arg0, arg1)
+#define TRACE_STRING(id, str, length)
+
+#endif // WIO_TRACE
+
+// Fixed-size events kept in a RAM ring buffer and formatted later, so tracing does not disturb the AT timing.
+// The oldest events are overwritten when the buffer is full.
+class Trace
+{
+public:
+	enum EventIdType {
+		EVENT_COMMAND = 1,		// arg0:length arg1:first 4 characters of verb
+		EVENT_RESPONSE,			// arg0:length arg1:first 4 characters
+		EVENT_URC,				// arg0:length arg1:first 4 characters
+		EVENT_TIMEOUT,			// arg1:timeout[msec.]
+		EVENT_OVERFLOW,			// arg1:length
+		EVENT_BINARY_WRITE,		// arg1:size
+		EVENT_BINARY_READ,		// arg1:size
+		EVENT_ERROR,			// arg0:line number arg1:error code
+		EVENT_BAUD_FALLBACK,	// arg1:restored baud rate
+	};
+
+	struct Event {
+		unsigned long Time;		// micros()
+		unsigned short Id;
+		short Arg0;
+		long Arg1;
+	};
+
+	static const int EVENT_NUM = 256;
+
+	static void Write(int id, int arg0, long arg1);
+	static void WriteString(int id, const char* str, int length);
+	static int Read(Event* events, int eventNum);		// Oldest first. Read events are removed.
+	static unsigned long GetLostNum();
+	static void Print();								// Formats all events to SerialUSB and removes them.
+
+};
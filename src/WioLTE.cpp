@@ -2,6 +2,7 @@
 #include "WioLTE.h"
 
 #include "Internal/Debug.h"
+#include "Internal/Trace.h"
 #include "Internal/StringBuilder.h"
 #include "Internal/ArgumentParser.h"
 #if defined ARDUINO_ARCH_STM32F4
@@ -17,20 +18,66 @@
 #define RET_OK(val)					(ReturnOk(val))
 #define RET_ERR(val,err)			(ReturnError(__LINE__, val, err))
 
-#define CONNECT_ID_NUM				(12)
 #define POLLING_INTERVAL			(100)
+#define RECEIVE_URC_WAIT_MAX		(1000)	// AT+QIRD is still issued at this interval in case a +QIURC: "recv" was missed.
+#define RECEIVE_SIZE_MAX			(1500)	// AT+QIRD
+#define SMS_LIST_INTERVAL			(1000)	// AT+CMGL is still issued at this interval in case a +CMTI was missed.
+#define SOCKET_OPEN_TIMEOUT			(150000)
+#define SOCKET_SEND_SEGMENT_SIZE	(1460)	// Maximum of AT+QISEND.
+#define SOCKET_SEND_WINDOW_TIMEOUT	(60000)	// Longest wait without any acknowledgement from the peer.
+
+#define COMMAND_SIZE				(200)	// Commands carrying user strings.
+#define NUMERIC_COMMAND_SIZE		(32)	// Commands carrying numbers only.
 
 #define HTTP_USER_AGENT				"QUECTEL_MODULE"
 #define HTTP_CONTENT_TYPE			"application/json"
 
 #define LINEAR_SCALE(val, inMin, inMax, outMin, outMax)	(((val) - (inMin)) / ((inMax) - (inMin)) * ((outMax) - (outMin)) + (outMin))
 
+////////////////////////////////////////////////////////////////////////////////////////
+// Response patterns
+
+static const AtPattern PATTERN_OK("^OK$");
+static const AtPattern PATTERN_OK_OR_ERROR("^(OK|ERROR)$");
+static const AtPattern PATTERNS_OK_OR_ERROR[] = { "^OK$", "^ERROR$" };
+static const AtPattern PATTERNS_CPIN[] = { "^OK$", "^\\+CPIN: READY$", "^\\+CME ERROR: .*$" };
+static const AtPattern PATTERNS_CMGL[] = { "^OK$", "^\\+CMGL: (.*)$" };
+static const AtPattern PATTERNS_CGMR[] = { "^OK$", "^([0-9A-Z_]+)$" };
+static const AtPattern PATTERNS_DIGITS[] = { "^OK$", "^([0-9]+)$" };
+static const AtPattern PATTERNS_QCCID[] = { "^OK$", "^\\+QCCID: (.*)$" };
+static const AtPattern PATTERNS_CNUM[] = { "^OK$", "^\\+CNUM: (.*)$" };
+static const AtPattern PATTERNS_IDENTITY[] = { "^OK$", "^([0-9]+)$", "^([0-9A-Z_]+)$", "^\\+QCCID: (.*)$", "^\\+CNUM: (.*)$" };
+static const AtPattern PATTERNS_QISTATE[] = { "^OK$", "^\\+QISTATE: (.*)$" };
+static const AtPattern PATTERNS_SEND[] = { "^SEND OK$", "^SEND FAIL$" };
+static const AtPattern PATTERN_CONNECT("^CONNECT$");
+static const AtPattern PATTERN_RDY("^RDY$");
+
+static const AtFields<int, int> FIELDS_CSQ("+CSQ: ");						// <rssi>,<ber>
+static const AtFields<int, int> FIELDS_CREG("+CREG: ");						// <n>,<stat>
+static const AtFields<int, int> FIELDS_CGREG("+CGREG: ");					// <n>,<stat>
+static const AtFields<int, int> FIELDS_CEREG("+CEREG: ");					// <n>,<stat>
+static const AtFields<double, double> FIELDS_QCELLLOC("+QCELLLOC: ");		// <longitude>,<latitude>
+static const AtFields<int, int, int> FIELDS_QHTTPGET("+QHTTPGET: ");		// <err>,<httprspcode>,<content_length>
+static const AtFields<int> FIELDS_QHTTPGET_ERROR("+QHTTPGET: ");			// <err>
+static const AtFields<int, int> FIELDS_QHTTPPOST("+QHTTPPOST: ");			// <err>,<httprspcode>
+static const AtFields<int> FIELDS_QHTTPPOST_ERROR("+QHTTPPOST: ");			// <err>
+static const AtFields<int, int, int> FIELDS_QISEND("+QISEND: ");				// <total_send_length>,<ackedbytes>,<unackedbytes>
+static const AtFields<int, int, int> FIELDS_QIRD_LENGTH("+QIRD: ");			// <total_receive_length>,<have_read_length>,<unread_length>
+static const AtFields<AtString, AtString, AtString, AtString, double, AtString, AtString, AtString, AtString, AtString> FIELDS_QGPSLOC("+QGPSLOC: ");	// <UTC>,<latitude>,<longitude>,<hdop>,<altitude>,<fix>,<cog>,<spkm>,<spkn>,<date>
+
+static const AtPattern PATTERNS_PS_REGISTRATION[] = { "^OK$", FIELDS_CGREG.GetPattern(), FIELDS_CEREG.GetPattern() };
+static const AtPattern PATTERNS_QCELLLOC[] = { FIELDS_QCELLLOC.GetPattern(), "^\\+CME ERROR: .*$" };
+static const AtPattern PATTERNS_QHTTPGET[] = { FIELDS_QHTTPGET.GetPattern(), FIELDS_QHTTPGET_ERROR.GetPattern() };
+static const AtPattern PATTERNS_QHTTPPOST[] = { FIELDS_QHTTPPOST.GetPattern(), FIELDS_QHTTPPOST_ERROR.GetPattern() };
+static const AtPattern PATTERNS_QIRD_LENGTH[] = { "^OK$", FIELDS_QIRD_LENGTH.GetPattern() };
+static const AtPattern PATTERNS_QGPSLOC[] = { "^OK$", FIELDS_QGPSLOC.GetPattern(), "^\\+CME ERROR: (.*)$" };
+
 ////////////////////////////////////////////////////////////////////////////////////////
 // Helper functions
 
-#if defined ARDUINO_ARCH_STM32
+#if !defined ARDUINO_ARCH_STM32F4
 typedef uint32_t WiringPinMode;
-#endif // ARDUINO_ARCH_STM32
+#endif // ARDUINO_ARCH_STM32F4
 
 static void PinModeAndDefault(int pin, WiringPinMode mode)
 {
@@ -125,6 +172,47 @@ static double GnssCoordinateToDecimal(double dddmm)
 	return deg + min / 60.0;
 }
 
+static bool DecodeGnssTime(const AtString& date, const AtString& time, struct tm* tim)
+{
+	const char* ymd = date.Ptr;	// date. ddmmyy
+	const char* hms = time.Ptr;	// time. hhmmss.s
+
+	if (date.Length != 6) return false;
+	if (time.Length < 6) return false;
+
+	int yearOffset = Convert2DigitsToInt(&ymd[4]);
+	tim->tm_year = (yearOffset >= 80 ? 1900 : 2000) + yearOffset - 1900;
+	tim->tm_mon = Convert2DigitsToInt(&ymd[2]) - 1;
+	tim->tm_mday = Convert2DigitsToInt(&ymd[0]);
+	tim->tm_hour = Convert2DigitsToInt(&hms[0]);
+	tim->tm_min = Convert2DigitsToInt(&hms[2]);
+	tim->tm_sec = Convert2DigitsToInt(&hms[4]);
+	tim->tm_wday = 0;
+	tim->tm_yday = 0;
+	tim->tm_isdst = 0;
+
+	// Update tm_wday and tm_yday
+	mktime(tim);
+
+	return true;
+}
+
+static int ParseRegistrationStat(const char* parameter)
+{
+	ArgumentParser parser;
+	parser.Parse(parameter);
+	if (parser.Size() == 2) return parser.AsInt(1);			// <n>,<stat> (read command response)
+	else if (parser.Size() >= 1) return parser.AsInt(0);	// <stat>[,...] (URC)
+	else return -1;
+}
+
+static bool IsRegistered(int stat)
+{
+	return stat == 1 || stat == 5;	// Registered, home network or roaming.
+}
+
+static const int MODULE_BAUDS[] = { 9600, 19200, 38400, 57600, 115200, 230400, 460800, 921600 };	// AT+IPR
+
 static void DelayArduino(int milliseconds)
 {
 	delay(milliseconds);
@@ -137,10 +225,8 @@ bool WioLTE::ReturnError(int lineNumber, bool value, WioLTE::ErrorCodeType error
 {
 	_LastErrorCode = errorCode;
 
-	char str[100];
-	sprintf(str, "%d", lineNumber);
-	DEBUG_PRINT("ERROR! ");
-	DEBUG_PRINTLN(str);
+	(void)lineNumber;	// Traced only.
+	TRACE(Trace::EVENT_ERROR, lineNumber, errorCode);
 
 	return value;
 }
@@ -149,39 +235,108 @@ int WioLTE::ReturnError(int lineNumber, int value, WioLTE::ErrorCodeType errorCo
 {
 	_LastErrorCode = errorCode;
 
-	char str[100];
-	sprintf(str, "%d", lineNumber);
-	DEBUG_PRINT("ERROR! ");
-	DEBUG_PRINTLN(str);
+	(void)lineNumber;	// Traced only.
+	TRACE(Trace::EVENT_ERROR, lineNumber, errorCode);
 
 	return value;
 }
 
+WioLTE::ErrorCodeType WioLTE::GetResponseError()
+{
+	if (!_AtSerial.IsErrorResponse()) return E_UNKNOWN;
+
+	_LastModuleError = _AtSerial.GetErrorCode();
+	return E_MODULE_ERROR;
+}
+
 bool WioLTE::IsRespond()
 {
 	Stopwatch sw;
 	sw.Restart();
-	while (!_AtSerial.WriteCommandAndReadResponse("AT", "^OK$", 500, NULL)) {
+	while (!_AtSerial.WriteCommandAndReadResponse("AT", PATTERN_OK, 500, NULL)) {
 		if (sw.ElapsedMilliseconds() >= 2000) return false;
 	}
 
 	return true;
 }
 
-bool WioLTE::Reset(long timeout)
+bool WioLTE::ProbeBaud()
 {
-	digitalWrite(RESET_MODULE_PIN, LOW);
-	_Delay(200);
-	digitalWrite(RESET_MODULE_PIN, HIGH);
-	_Delay(300);
+	// The module may still run at the rate saved by a previous NegotiateBaud().
+	int currentBaud = _SerialAPI.GetBaud();
+	if (IsRespond()) return true;
+
+	if (_ModuleBaud != currentBaud) {
+		_SerialAPI.Begin(_ModuleBaud);
+		if (IsRespond()) return true;
+	}
+	if (MODULE_DEFAULT_BAUD != currentBaud && MODULE_DEFAULT_BAUD != _ModuleBaud) {
+		_SerialAPI.Begin(MODULE_DEFAULT_BAUD);
+		if (IsRespond()) return true;
+	}
+
+	_SerialAPI.Begin(currentBaud);
+	return false;
+}
+
+bool WioLTE::ScanBaud()
+{
+	// A rate saved by another sketch. NegotiateBaud() then saves the requested one over it.
+	int currentBaud = _SerialAPI.GetBaud();
+	for (int i = 0; i < (int)(sizeof (MODULE_BAUDS) / sizeof (MODULE_BAUDS[0])); i++) {
+		_SerialAPI.Begin(MODULE_BAUDS[i]);
+		if (IsRespond()) return true;
+	}
+
+	_SerialAPI.Begin(currentBaud);
+	return false;
+}
+
+bool WioLTE::NegotiateBaud(long timeout)
+{
+	int currentBaud = _SerialAPI.GetBaud();
+	if (_ModuleBaud == currentBaud) return true;
+
+	StringBuilder<NUMERIC_COMMAND_SIZE> str;
+	str.Write("AT+IPR=");
+	str.WriteInt(_ModuleBaud);
+	if (str.IsOverflow()) return false;
+	_AtSerial.WriteCommand(str.GetString());
+	int index = _AtSerial.ReadResponse(PATTERNS_OK_OR_ERROR, 500, NULL, 0);
+	if (index < 0) return IsRespond();
+	if (index != 0) return true;	// Not supported, keep the current rate.
+
+	_SerialAPI.Begin(_ModuleBaud);
+	if (IsRespond()) {
+		// Save it so that the module starts at this rate next time.
+		return _AtSerial.WriteCommandAndReadResponse("AT&W", PATTERN_OK, 500, NULL);
+	}
+
+	// The new rate has not been saved yet, so a reset brings the module back to the previous one.
+	TRACE(Trace::EVENT_BAUD_FALLBACK, 0, currentBaud);
+	_SerialAPI.Begin(currentBaud);
+	if (!Reset(timeout)) return false;
+
+	return IsRespond();
+}
+
+bool WioLTE::WaitForRdy(long timeout)
+{
+	// The boot is accounted as "RDY", not as part of the last command.
+	AtStatistics* statistics = _AtSerial.GetStatistics();
+	statistics->Commit();
 
 	Stopwatch sw;
 	sw.Restart();
-	while (!_AtSerial.ReadResponse("^RDY$", 100, NULL)) {
+	while (!_AtSerial.ReadResponse(PATTERN_RDY, 100, NULL)) {
 		DEBUG_PRINT(".");
-		if (sw.ElapsedMilliseconds() >= timeout) return false;
+		if (sw.ElapsedMilliseconds() >= timeout) {
+			statistics->Record("RDY", sw.ElapsedMilliseconds(), true, false);
+			return false;
+		}
 	}
 	DEBUG_PRINTLN("");
+	statistics->Record("RDY", sw.ElapsedMilliseconds(), false, false);
 
 #ifdef WIO_DEBUG
 	char dbg[100];
@@ -192,6 +347,16 @@ bool WioLTE::Reset(long timeout)
 	return true;
 }
 
+bool WioLTE::Reset(long timeout)
+{
+	digitalWrite(RESET_MODULE_PIN, LOW);
+	_Delay(200);
+	digitalWrite(RESET_MODULE_PIN, HIGH);
+	_Delay(300);
+
+	return WaitForRdy(timeout);
+}
+
 bool WioLTE::TurnOn(long timeout)
 {
 	_Delay(100);
@@ -199,130 +364,272 @@ bool WioLTE::TurnOn(long timeout)
 	_Delay(200);
 	digitalWrite(PWR_KEY_PIN, LOW);
 
-	Stopwatch sw;
-	sw.Restart();
-	while (!_AtSerial.ReadResponse("^RDY$", 100, NULL)) {
-		DEBUG_PRINT(".");
-		if (sw.ElapsedMilliseconds() >= timeout) return false;
-	}
-	DEBUG_PRINTLN("");
-
-#ifdef WIO_DEBUG
-	char dbg[100];
-	sprintf(dbg, "Elapsed time is %lu[msec.].", sw.ElapsedMilliseconds());
-	DEBUG_PRINTLN(dbg);
-#endif // WIO_DEBUG
-
-	return true;
+	return WaitForRdy(timeout);
 }
 
 int WioLTE::GetFirstIndexOfReceivedSMS()
 {
-	std::string response;
+	slre_cap cap;
 	ArgumentParser parser;
 
-	if (!_AtSerial.WriteCommandAndReadResponse("AT+CMGF=0", "^OK$", 500, NULL)) return -1;
+	// A pending +CMTI may change what is known about the storage.
+	while (_AtSerial.ReadUrc(0)) {}
+	if (_ReceivedSMSIndex != -1 && _ReceivedSMSStopwatch.ElapsedMilliseconds() < SMS_LIST_INTERVAL) return _ReceivedSMSIndex;
+
+	if (!_AtSerial.WriteCommandAndReadResponse("AT+CMGF=0", PATTERN_OK, 500, NULL)) return -1;
 
 	_AtSerial.WriteCommand("AT+CMGL=4");	// ALL
 
 	int messageIndex = -1;
+	int messageNum = 0;
 	while (true) {
-		if (!_AtSerial.ReadResponse("^(OK|\\+CMGL: .*)$", 500, &response)) return -1;
-		if (response == "OK") break;
+		int index = _AtSerial.ReadResponse(PATTERNS_CMGL, 500, &cap, 1);
+		if (index < 0) return -1;
+		if (index == 0) break;
 		if (messageIndex < 0) {
-			parser.Parse(&response.c_str()[7]);
+			parser.Parse(cap.ptr, cap.len);
 			if (parser.Size() != 4) return -1;
-			messageIndex = atoi(parser[0]);
+			messageIndex = parser.AsInt(0);
 		}
+		messageNum++;
 
 		if (!_AtSerial.ReadResponse("^.*$", 500, NULL)) return -1;
 	}
 
+	// The storage is known while it holds at most one message, and +CMTI keeps it so.
+	_ReceivedSMSIndex = messageNum == 0 ? -2 : messageNum == 1 ? messageIndex : -1;
+	_ReceivedSMSStopwatch.Restart();
+
 	return messageIndex < 0 ? -2 : messageIndex;
 }
 
 bool WioLTE::HttpSetUrl(const char* url)
 {
-	StringBuilder str;
-	if (!str.WriteFormat("AT+QHTTPURL=%d", strlen(url))) return false;
+	StringBuilder<NUMERIC_COMMAND_SIZE> str;
+	str.Write("AT+QHTTPURL=");
+	str.WriteInt(strlen(url));
+	if (str.IsOverflow()) return false;
 	_AtSerial.WriteCommand(str.GetString());
-	if (!_AtSerial.ReadResponse("^CONNECT$", 500, NULL)) return false;
+	if (!_AtSerial.ReadResponse(PATTERN_CONNECT, 500, NULL)) return false;
 
 	_AtSerial.WriteBinary((const byte*)url, strlen(url));
-	if (!_AtSerial.ReadResponse("^OK$", 500, NULL)) return false;
+	if (!_AtSerial.ReadResponse(PATTERN_OK, 500, NULL)) return false;
 
 	return true;
 }
 
-bool WioLTE::ReadResponseCallback(const char* response)
+bool WioLTE::SyncSocketTable()
 {
-	return false;
+	slre_cap cap;
+	ArgumentParser parser;
 
-	if (strncmp(response, "+CGREG: ", 8) == 0) {
-		DEBUG_PRINT("### Response Callback +CGREG ### ");
-		DEBUG_PRINTLN(response);
-
-		//ArgumentParser parser;
-		//parser.Parse(&response[8]);
-		//int stat;
-		//if (parser.Size() == 2) {
-		//	stat = atoi(parser[1]);
-		//}
-		//else if (parser.Size() >= 1) {
-		//	stat = atoi(parser[0]);
-		//}
-		//else {
-		//	stat = -1;
-		//}
-
-		//switch (stat)
-		//{
-		//case 0:	// Not registered. MT is not currently searching
-		//case 2:	// Not registered, but MT is currently trying to attach or searching
-		//case 3:	// Registration denied.
-		//	_PacketGprsNetworkRegistration = false;
-		//	DEBUG_PRINTLN("NETWORK OFF");
-		//	break;
-		//case 1:	// Registered, home network.
-		//case 5:	// Registered, roaming
-		//	_PacketGprsNetworkRegistration = true;
-		//	DEBUG_PRINTLN("NETWORK ON");
-		//	break;
-		//}
+	for (int i = 0; i < CONNECT_ID_NUM; i++) FreeSocket(i);
 
-		return true;
+	_AtSerial.WriteCommand("AT+QISTATE?");
+	while (true) {
+		int index = _AtSerial.ReadResponse(PATTERNS_QISTATE, 10000, &cap, 1);
+		if (index < 0) return false;
+		if (index == 0) break;
+
+		// <connectID>,<service_type>,<IP_address>,<remote_port>,<local_port>,<socket_state>,...
+		parser.Parse(cap.ptr, cap.len);
+		if (parser.Size() < 6) return false;
+		int connectId = parser.AsInt(0);
+		if (connectId < 0 || CONNECT_ID_NUM <= connectId) return false;
+
+		SocketEntry& socket = _Sockets[connectId];
+		switch (parser.AsInt(5)) {
+		case 1:
+			socket.State = SOCKET_OPENING;
+			break;
+		case 2:
+		case 3:
+			socket.State = SOCKET_OPEN;
+			socket.OpenResult = 0;
+			break;
+		default:
+			socket.State = SOCKET_CLOSED;
+			break;
+		}
+		socket.Type = parser.Length(1) == 3 && strncmp(parser.Pointer(1), "UDP", 3) == 0 ? SOCKET_UDP : SOCKET_TCP;
+	}
+
+	_SocketTableSynced = true;
+
+	return true;
+}
+
+bool WioLTE::QuerySocketUnread(const int* connectIds, int connectIdNum)
+{
+	// "AT+QIRD=<id>,0;+QIRD=<id>,0;..." answers one +QIRD line per open socket, in order.
+	int queryIds[CONNECT_ID_NUM];
+	int queryIdNum = 0;
+	StringBuilder<COMMAND_SIZE> str;
+	str.Write("AT");
+	for (int i = 0; i < connectIdNum; i++) {
+		if (_Sockets[connectIds[i]].State != SOCKET_OPEN) continue;
+		bool queried = false;
+		for (int j = 0; j < queryIdNum; j++) queried = queried || queryIds[j] == connectIds[i];
+		if (queried) continue;
+
+		str.Write(queryIdNum >= 1 ? ";+QIRD=" : "+QIRD=");
+		str.WriteInt(connectIds[i]);
+		str.Write(",0");
+		queryIds[queryIdNum++] = connectIds[i];
+	}
+	if (queryIdNum <= 0) return true;
+	if (str.IsOverflow()) return false;
+
+	slre_cap caps[FIELDS_QIRD_LENGTH.CAPTURE_NUM];
+	int lineNum = 0;
+	_AtSerial.WriteCommand(str.GetString());
+	while (true) {
+		int index = _AtSerial.ReadResponse(PATTERNS_QIRD_LENGTH, 500, caps, FIELDS_QIRD_LENGTH.CAPTURE_NUM);
+		if (index < 0) return false;
+		if (index == 0) break;
+
+		int unreadLength;
+		FIELDS_QIRD_LENGTH.Decode(caps, NULL, NULL, &unreadLength);
+		if (lineNum < queryIdNum && unreadLength >= 1) _Sockets[queryIds[lineNum]].ReceivePending = true;
+		lineNum++;
+	}
+
+	return true;
+}
+
+int WioLTE::GetSocketEvents(const int* connectIds, int* events, int connectIdNum)
+{
+	int eventNum = 0;
+	for (int i = 0; i < connectIdNum; i++) {
+		const SocketEntry& socket = _Sockets[connectIds[i]];
+		events[i] = 0;
+		if (socket.ReceivePending) events[i] |= SOCKET_EVENT_READABLE;
+		if (socket.State == SOCKET_CLOSED) events[i] |= SOCKET_EVENT_CLOSED;
+		if (events[i] != 0) eventNum++;
 	}
-	else if (strncmp(response, "+CEREG: ", 8) == 0) {
-		DEBUG_PRINT("### Response Callback +CEREG ### ");
-		DEBUG_PRINTLN(response);
-
-		//ArgumentParser parser;
-		//parser.Parse(&response[8]);
-		//int stat;
-		//if (parser.Size() == 2) {
-		//	stat = atoi(parser[1]);
-		//}
-		//else if (parser.Size() >= 1) {
-		//	stat = atoi(parser[0]);
-		//}
-		//else {
-		//	stat = -1;
-		//}
-
-		//switch (stat)
-		//{
-		//case 0:	// Not registered. MT is not currently searching
-		//case 2:	// Not registered, but MT is currently trying to attach or searching
-		//case 3:	// Registration denied
-		//	_PacketEpsNetworkRegistration = false;
-		//	DEBUG_PRINTLN("NETWORK OFF");
-		//	break;
-		//case 1:	// Registered, home network
-		//case 5:	// Registered, roaming
-		//	_PacketEpsNetworkRegistration = true;
-		//	DEBUG_PRINTLN("NETWORK ON");
-		//	break;
-		//}
+
+	return eventNum;
+}
+
+void WioLTE::FreeSocket(int connectId)
+{
+	SocketEntry& socket = _Sockets[connectId];
+	socket.State = SOCKET_FREE;
+	socket.Type = SOCKET_TCP;
+	socket.OpenResult = -1;
+	socket.OpenRecorded = true;
+	socket.ReceivePending = false;
+}
+
+void WioLTE::ClearUrcState()
+{
+	_PacketGprsNetworkStat = -1;
+	_PacketEpsNetworkStat = -1;
+	_SimReady = false;
+	_ReceivedSMSIndex = -1;
+	for (int i = 0; i < CONNECT_ID_NUM; i++) FreeSocket(i);
+	_SocketTableSynced = false;
+}
+
+void WioLTE::UrcQIURCRecv(const char* parameter)
+{
+	int connectId = atoi(parameter);
+	if (connectId < 0 || CONNECT_ID_NUM <= connectId) return;
+
+	_Sockets[connectId].ReceivePending = true;
+}
+
+void WioLTE::UrcQIURCClosed(const char* parameter)
+{
+	int connectId = atoi(parameter);
+	if (connectId < 0 || CONNECT_ID_NUM <= connectId) return;
+
+	if (_Sockets[connectId].State != SOCKET_FREE) _Sockets[connectId].State = SOCKET_CLOSED;
+}
+
+void WioLTE::UrcQIURCPdpDeact(const char*)
+{
+	// Every socket on the context is gone, but each id is held until it is closed.
+	for (int i = 0; i < CONNECT_ID_NUM; i++) {
+		if (_Sockets[i].State != SOCKET_FREE) _Sockets[i].State = SOCKET_CLOSED;
+	}
+}
+
+void WioLTE::UrcCMTI(const char* parameter)
+{
+	ArgumentParser parser;
+	parser.Parse(parameter);
+	if (parser.Size() < 2) return;
+
+	// The new message is the first only when the storage was known to be empty.
+	_ReceivedSMSIndex = _ReceivedSMSIndex == -2 ? parser.AsInt(1) : -1;
+}
+
+void WioLTE::UrcCGREG(const char* parameter)
+{
+	int stat = ParseRegistrationStat(parameter);
+	if (stat < 0) return;
+
+	_PacketGprsNetworkStat = stat;
+	DEBUG_PRINTLN(IsRegistered(stat) ? "NETWORK ON" : "NETWORK OFF");
+}
+
+void WioLTE::UrcCEREG(const char* parameter)
+{
+	int stat = ParseRegistrationStat(parameter);
+	if (stat < 0) return;
+
+	_PacketEpsNetworkStat = stat;
+	DEBUG_PRINTLN(IsRegistered(stat) ? "NETWORK ON" : "NETWORK OFF");
+}
+
+void WioLTE::UrcQIOPEN(const char* parameter)
+{
+	ArgumentParser parser;
+	parser.Parse(parameter);
+	if (parser.Size() < 2) return;
+	int connectId = parser.AsInt(0);
+	if (connectId < 0 || CONNECT_ID_NUM <= connectId) return;
+
+	SocketEntry& socket = _Sockets[connectId];
+	socket.OpenResult = parser.AsInt(1);
+	if (!socket.OpenRecorded) {
+		_AtSerial.GetStatistics()->Record("+QIOPEN", socket.OpenStopwatch.ElapsedMilliseconds(), false, socket.OpenResult != 0);
+		socket.OpenRecorded = true;
+	}
+	if (socket.State == SOCKET_OPENING && socket.OpenResult == 0) socket.State = SOCKET_OPEN;
+}
+
+void WioLTE::UrcCPIN(const char* parameter)
+{
+	_SimReady = strcmp(parameter, "READY") == 0;
+}
+
+bool WioLTE::ReadResponseCallback(const char* response)
+{
+	static const struct {
+		const char* Prefix;
+		void (WioLTE::*Handler)(const char* parameter);
+	} urcTable[] = {
+		{ "+QIURC: \"recv\","  , &WioLTE::UrcQIURCRecv },
+		{ "+QIURC: \"closed\",", &WioLTE::UrcQIURCClosed },
+		{ "+QIURC: \"pdpdeact\",", &WioLTE::UrcQIURCPdpDeact },
+		{ "+QIURC: "          , NULL },	// Passed to the user function only.
+		{ "+CMTI: "           , &WioLTE::UrcCMTI },
+		{ "+CGREG: "          , &WioLTE::UrcCGREG },
+		{ "+CEREG: "          , &WioLTE::UrcCEREG },
+		{ "+QIOPEN: "         , &WioLTE::UrcQIOPEN },
+		{ "+CPIN: "           , &WioLTE::UrcCPIN },
+	};
+
+	for (int i = 0; i < (int)(sizeof (urcTable) / sizeof (urcTable[0])); i++) {
+		int prefixLength = strlen(urcTable[i].Prefix);
+		if (strncmp(response, urcTable[i].Prefix, prefixLength) != 0) continue;
+
+		TRACE_STRING(Trace::EVENT_URC, response, strlen(response));
+
+		if (urcTable[i].Handler != NULL) (this->*urcTable[i].Handler)(&response[prefixLength]);
+		if (_UrcFunction) _UrcFunction(response);
 
 		return true;
 	}
@@ -336,7 +643,11 @@ WioLTE::WioLTE() :
 	_AtSerial(&_SerialAPI, this), 
 	_Led(1, RGB_LED_PIN), 
 	_LastErrorCode(E_OK), 
-	_Delay{ DelayArduino }
+	_LastModuleError(-1), 
+	_Delay{ DelayArduino }, 
+	_ModuleBaud(MODULE_DEFAULT_BAUD), 
+	_SocketSendWindow(0), 
+	_UrcFunction{ nullptr }
 {
 }
 #elif defined ARDUINO_ARCH_STM32
@@ -345,7 +656,24 @@ WioLTE::WioLTE() :
 	_AtSerial(&_SerialAPI, this), 
 	_Led(), 
 	_LastErrorCode(E_OK), 
-	_Delay{ DelayArduino }
+	_LastModuleError(-1), 
+	_Delay{ DelayArduino }, 
+	_ModuleBaud(MODULE_DEFAULT_BAUD), 
+	_SocketSendWindow(0), 
+	_UrcFunction{ nullptr }
+{
+}
+#else
+// Host build: SerialModule is supplied by the SerialAPI backend.
+WioLTE::WioLTE() : 
+	_SerialAPI(&SerialModule), 
+	_AtSerial(&_SerialAPI, this), 
+	_LastErrorCode(E_OK), 
+	_LastModuleError(-1), 
+	_Delay{ DelayArduino }, 
+	_ModuleBaud(MODULE_DEFAULT_BAUD), 
+	_SocketSendWindow(0), 
+	_UrcFunction{ nullptr }
 {
 }
 #endif
@@ -355,6 +683,11 @@ WioLTE::ErrorCodeType WioLTE::GetLastError() const
 	return _LastErrorCode;
 }
 
+int WioLTE::GetLastModuleError() const
+{
+	return _LastModuleError;
+}
+
 void WioLTE::SetDelayFunction(std::function<void(int)> func)
 {
 	_Delay = func;
@@ -365,6 +698,61 @@ void WioLTE::SetDoWorkInWaitForAvailableFunction(std::function<void()> func)
 	_AtSerial.SetDoWorkInWaitForAvailableFunction(func);
 }
 
+void WioLTE::SetUrcFunction(std::function<void(const char*)> func)
+{
+	_UrcFunction = func;
+}
+
+void WioLTE::SetTranscriptFunction(std::function<void(const byte*, int)> func)
+{
+	_AtSerial.SetTranscriptFunction(func);
+}
+
+void WioLTE::SetModuleBaud(int baud)
+{
+	_ModuleBaud = baud;
+}
+
+void WioLTE::SetSocketSendWindow(int windowSize)
+{
+	_SocketSendWindow = windowSize;
+}
+
+void WioLTE::GetStatistics(AtStatistics* statistics, bool clear)
+{
+	AtStatistics* current = _AtSerial.GetStatistics();
+	current->Commit();
+	*statistics = *current;
+	if (clear) current->Clear();
+}
+
+int WioLTE::ReadTrace(Trace::Event* events, int eventNum)
+{
+#ifdef WIO_TRACE
+	return Trace::Read(events, eventNum);
+#else
+	(void)events;
+	(void)eventNum;
+	return 0;
+#endif // WIO_TRACE
+}
+
+unsigned long WioLTE::GetTraceLostNum()
+{
+#ifdef WIO_TRACE
+	return Trace::GetLostNum();
+#else
+	return 0;
+#endif // WIO_TRACE
+}
+
+void WioLTE::PrintTrace()
+{
+#ifdef WIO_TRACE
+	Trace::Print();
+#endif // WIO_TRACE
+}
+
 void WioLTE::Init()
 {
 	// Power supply
@@ -391,7 +779,7 @@ void WioLTE::Init()
 	PinModeAndDefault(W_DISABLE_PIN, OUTPUT, HIGH);
 	//PinModeAndDefault(AP_READY_PIN, OUTPUT);  // NOT use
   
-	_SerialAPI.Begin(115200);
+	_SerialAPI.Begin(MODULE_DEFAULT_BAUD);
 #if defined ARDUINO_ARCH_STM32F4
 	_Led.begin();
 #elif defined ARDUINO_ARCH_STM32
@@ -399,8 +787,8 @@ void WioLTE::Init()
 #endif
 	_LastErrorCode = E_OK;
 
-	_PacketGprsNetworkRegistration = false;
-	_PacketEpsNetworkRegistration = false;
+	ClearUrcState();
+	ClearIdentity();
 }
 
 void WioLTE::PowerSupplyLTE(bool on)
@@ -450,6 +838,10 @@ void WioLTE::LedSetRGB(byte red, byte green, byte blue)
 #elif defined ARDUINO_ARCH_STM32
 	_Led.Reset();
 	_Led.SetSingleLED(red, green, blue);
+#else
+	(void)red;
+	(void)green;
+	(void)blue;
 #endif
 
 	_LastErrorCode = E_OK;
@@ -457,67 +849,63 @@ void WioLTE::LedSetRGB(byte red, byte green, byte blue)
 
 bool WioLTE::TurnOnOrReset(long timeout)
 {
-	std::string response;
+	ClearUrcState();
+	ClearIdentity();
 
-	if (IsRespond()) {
+	if (ProbeBaud()) {
 		DEBUG_PRINTLN("Reset()");
 		if (!Reset(timeout)) return RET_ERR(false, E_UNKNOWN);
 	}
 	else {
 		DEBUG_PRINTLN("TurnOn()");
-		if (!TurnOn(timeout)) return RET_ERR(false, E_UNKNOWN);
+		// The module starts at its saved rate, which is the requested one once it has been negotiated.
+		_SerialAPI.Begin(_ModuleBaud);
+		if (!TurnOn(timeout) && !ProbeBaud() && !ScanBaud()) return RET_ERR(false, E_UNKNOWN);
 	}
 
 	Stopwatch sw;
 	sw.Restart();
-	while (!_AtSerial.WriteCommandAndReadResponse("AT", "^OK$", 500, NULL)) {
+	while (!_AtSerial.WriteCommandAndReadResponse("AT", PATTERN_OK, 500, NULL)) {
 		DEBUG_PRINT(".");
 		if (sw.ElapsedMilliseconds() >= 10000) return RET_ERR(false, E_UNKNOWN);
 	}
 	DEBUG_PRINTLN("");
 
-	if (!_AtSerial.WriteCommandAndReadResponse("ATE0", "^OK$", 500, NULL)) return RET_ERR(false, E_UNKNOWN);
-	if (!_AtSerial.WriteCommandAndReadResponse("AT+QURCCFG=\"urcport\",\"uart1\"", "^OK$", 500, NULL)) return RET_ERR(false, E_UNKNOWN);
-	if (!_AtSerial.WriteCommandAndReadResponse("AT+QSCLK=1", "^(OK|ERROR)$", 500, NULL)) return RET_ERR(false, E_UNKNOWN);
+	if (!NegotiateBaud(timeout)) return RET_ERR(false, E_UNKNOWN);
 
-	// TODO ReadResponseCallback
-	//if (!_AtSerial.WriteCommandAndReadResponse("AT+CGREG=2", "^OK$", 500, NULL)) return RET_ERR(false, E_UNKNOWN);
-	//if (!_AtSerial.WriteCommandAndReadResponse("AT+CEREG=2", "^OK$", 500, NULL)) return RET_ERR(false, E_UNKNOWN);
-	//if (!_AtSerial.WriteCommandAndReadResponse("AT+CGREG?", "^OK$", 500, NULL)) return RET_ERR(false, E_UNKNOWN);
-	//if (!_AtSerial.WriteCommandAndReadResponse("AT+CEREG?", "^OK$", 500, NULL)) return RET_ERR(false, E_UNKNOWN);
+	if (!_AtSerial.WriteCommandAndReadResponse("ATE0", PATTERN_OK, 500, NULL)) return RET_ERR(false, E_UNKNOWN);
+	if (!_AtSerial.WriteCommandAndReadResponse("AT+QURCCFG=\"urcport\",\"uart1\"", PATTERN_OK, 500, NULL)) return RET_ERR(false, E_UNKNOWN);
+	if (!_AtSerial.WriteCommandAndReadResponse("AT+QSCLK=1", PATTERN_OK_OR_ERROR, 500, NULL)) return RET_ERR(false, E_UNKNOWN);
 
 	sw.Restart();
-	bool cpinReady;
-	while (true) {
+	while (!_SimReady) {
 		_AtSerial.WriteCommand("AT+CPIN?");
-		cpinReady = false;
-		while (true) {
-			if (!_AtSerial.ReadResponse("^(OK|\\+CPIN: READY|\\+CME ERROR: .*)$", 500, &response)) return RET_ERR(false, E_UNKNOWN);
-			if (response == "+CPIN: READY") {
-				cpinReady = true;
-				continue;
-			}
-			break;
-		}
-		if (response == "OK" && cpinReady) break;
+		bool cpinReady = false;
+		int index;
+		while ((index = _AtSerial.ReadResponse(PATTERNS_CPIN, 500, NULL, 0)) == 1) cpinReady = true;
+		if (index < 0) return RET_ERR(false, E_UNKNOWN);
+		if (index == 0 && cpinReady) break;
 
 		if (sw.ElapsedMilliseconds() >= 10000) return RET_ERR(false, E_UNKNOWN);
 		_Delay(POLLING_INTERVAL);
 	}
 
+	if (!_AtSerial.WriteCommandAndReadResponse("AT+CGREG=1", PATTERN_OK, 500, NULL)) return RET_ERR(false, E_UNKNOWN);
+	if (!_AtSerial.WriteCommandAndReadResponse("AT+CEREG=1", PATTERN_OK, 500, NULL)) return RET_ERR(false, E_UNKNOWN);
+	if (!_AtSerial.WriteCommandAndReadResponse("AT+CNMI=2,1", PATTERN_OK, 500, NULL)) return RET_ERR(false, E_UNKNOWN);	// +CMTI for each new SMS.
+
 	return RET_OK(true);
 }
 
 bool WioLTE::TurnOff(long timeout)
 {
-	std::string response;
-
 	Stopwatch sw;
 	sw.Restart();
 	while (true) {
 		_AtSerial.WriteCommand("AT+QPOWD");
-		if (!_AtSerial.ReadResponse("^(OK|ERROR)$", 500, &response)) return RET_ERR(false, E_UNKNOWN);
-		if (response == "OK") break;
+		int index = _AtSerial.ReadResponse(PATTERNS_OK_OR_ERROR, 500, NULL, 0);
+		if (index < 0) return RET_ERR(false, E_UNKNOWN);
+		if (index == 0) break;
 		if (sw.ElapsedMilliseconds() >= (unsigned long)timeout) return RET_ERR(false, E_UNKNOWN);
 		_Delay(POLLING_INTERVAL);
 	}
@@ -540,7 +928,7 @@ bool WioLTE::Wakeup()
 
 	Stopwatch sw;
 	sw.Restart();
-	while (!_AtSerial.WriteCommandAndReadResponse("AT", "^OK$", 500, NULL)) {
+	while (!_AtSerial.WriteCommandAndReadResponse("AT", PATTERN_OK, 500, NULL)) {
 		DEBUG_PRINT(".");
 		if (sw.ElapsedMilliseconds() >= 2000) return RET_ERR(false, E_UNKNOWN);
 	}
@@ -549,112 +937,148 @@ bool WioLTE::Wakeup()
 	return RET_OK(true);
 }
 
-int WioLTE::GetRevision(char* revision, int revisionSize)
+void WioLTE::ClearIdentity()
 {
-	std::string response;
-	std::string revisionStr;
+	_IdentityRead = false;
+	_Revision.clear();
+	_Imei.clear();
+	_Imsi.clear();
+	_Iccid.clear();
+	_PhoneNumber.clear();
+	_PhoneNumberRead = false;
+}
+
+void WioLTE::ReadIdentity()
+{
+	slre_cap cap;
+	ArgumentParser parser;
+	int digitsNum = 0;
 
-	_AtSerial.WriteCommand("AT+CGMR");
+	// One exchange for all values. The chain stops at the first error (e.g. no SIM), and the values before it are kept.
+	_IdentityRead = true;
+	_AtSerial.WriteCommand("AT+CGMR;+GSN;+CIMI;+QCCID;+CNUM");
 	while (true) {
-		if (!_AtSerial.ReadResponse("^(OK|[0-9A-Z_]+)$", 500, &response)) return RET_ERR(-1, E_UNKNOWN);
-		if (response == "OK") break;
-		revisionStr = response;
+		int index = _AtSerial.ReadResponse(PATTERNS_IDENTITY, 500, &cap, 1);
+		switch (index) {
+		case 0:
+			_PhoneNumberRead = true;
+			return;
+		case 1:
+			// Both are bare digits of the same length, so they are told apart by order. +GSN precedes +CIMI in the chain, and an error in +GSN would have ended it.
+			(digitsNum++ == 0 ? _Imei : _Imsi).assign(cap.ptr, cap.len);
+			break;
+		case 2:
+			_Revision.assign(cap.ptr, cap.len);
+			break;
+		case 3:
+			if (cap.len >= 1) _Iccid.assign(cap.ptr, cap.len - 1);
+			break;
+		case 4:
+			if (_PhoneNumber.size() >= 1) break;
+			parser.Parse(cap.ptr, cap.len);
+			if (parser.Size() >= 2) _PhoneNumber.assign(parser.Pointer(1), parser.Length(1));
+			break;
+		default:
+			return;
+		}
 	}
+}
 
-	if ((int)revisionStr.size() + 1 > revisionSize) return RET_ERR(-1, E_UNKNOWN);
-	strcpy(revision, revisionStr.c_str());
+int WioLTE::CopyIdentity(const std::string& value, char* str, int size)
+{
+	if ((int)value.size() + 1 > size) return RET_ERR(-1, E_UNKNOWN);
+	strcpy(str, value.c_str());
 
-	return RET_OK((int)strlen(revision));
+	return RET_OK((int)value.size());
 }
 
-int WioLTE::GetIMEI(char* imei, int imeiSize)
+bool WioLTE::ReadIdentityValue(const char* command, const AtPattern (&patterns)[2], std::string* value)
 {
-	std::string response;
-	std::string imeiStr;
+	slre_cap cap;
+	std::string valueStr;
 
-	_AtSerial.WriteCommand("AT+GSN");
+	// patterns are OK and the value line. The first value line is taken.
+	_AtSerial.WriteCommand(command);
 	while (true) {
-		if (!_AtSerial.ReadResponse("^(OK|[0-9]+)$", 500, &response)) return RET_ERR(-1, E_UNKNOWN);
-		if (response == "OK") break;
-		imeiStr = response;
+		int index = _AtSerial.ReadResponse(patterns, 500, &cap, 1);
+		if (index < 0) return false;
+		if (index == 0) break;
+		if (valueStr.size() <= 0) valueStr.assign(cap.ptr, cap.len);
 	}
+	*value = valueStr;
+
+	return true;
+}
 
-	if ((int)imeiStr.size() + 1 > imeiSize) return RET_ERR(-1, E_UNKNOWN);
-	strcpy(imei, imeiStr.c_str());
+int WioLTE::GetRevision(char* revision, int revisionSize)
+{
+	if (!_IdentityRead) ReadIdentity();
+
+	if (_Revision.size() <= 0 && !ReadIdentityValue("AT+CGMR", PATTERNS_CGMR, &_Revision)) return RET_ERR(-1, E_UNKNOWN);
 
-	return RET_OK((int)strlen(imei));
+	return CopyIdentity(_Revision, revision, revisionSize);
 }
 
-int WioLTE::GetIMSI(char* imsi, int imsiSize)
+int WioLTE::GetIMEI(char* imei, int imeiSize)
 {
-	std::string response;
-	std::string imsiStr;
+	if (!_IdentityRead) ReadIdentity();
 
-	_AtSerial.WriteCommand("AT+CIMI");
-	while (true) {
-		if (!_AtSerial.ReadResponse("^(OK|[0-9]+)$", 500, &response)) return RET_ERR(-1, E_UNKNOWN);
-		if (response == "OK") break;
-		imsiStr = response;
-	}
+	if (_Imei.size() <= 0 && !ReadIdentityValue("AT+GSN", PATTERNS_DIGITS, &_Imei)) return RET_ERR(-1, E_UNKNOWN);
+
+	return CopyIdentity(_Imei, imei, imeiSize);
+}
 
-	if ((int)imsiStr.size() + 1 > imsiSize) return RET_ERR(-1, E_UNKNOWN);
-	strcpy(imsi, imsiStr.c_str());
+int WioLTE::GetIMSI(char* imsi, int imsiSize)
+{
+	if (!_IdentityRead) ReadIdentity();
 
-	return RET_OK((int)strlen(imsi));
+	if (_Imsi.size() <= 0 && !ReadIdentityValue("AT+CIMI", PATTERNS_DIGITS, &_Imsi)) return RET_ERR(-1, E_UNKNOWN);
+
+	return CopyIdentity(_Imsi, imsi, imsiSize);
 }
 
 int WioLTE::GetICCID(char* iccid, int iccidSize)
 {
-	std::string response;
+	if (!_IdentityRead) ReadIdentity();
 
-	_AtSerial.WriteCommand("AT+QCCID");
-	if (!_AtSerial.ReadResponse("^\\+QCCID: (.*)$", 500, &response)) return RET_ERR(-1, E_UNKNOWN);
-	if (!_AtSerial.ReadResponse("^OK$", 500, NULL)) return RET_ERR(-1, E_UNKNOWN);
-	response.erase(response.size() - 1, 1);
+	if (_Iccid.size() <= 0) {
+		std::string response;
 
-	if ((int)response.size() + 1 > iccidSize) return RET_ERR(-1, E_UNKNOWN);
-	strcpy(iccid, response.c_str());
+		if (!ReadIdentityValue("AT+QCCID", PATTERNS_QCCID, &response)) return RET_ERR(-1, E_UNKNOWN);
+		if (response.size() >= 1) _Iccid.assign(response, 0, response.size() - 1);
+	}
 
-	return RET_OK((int)strlen(iccid));
+	return CopyIdentity(_Iccid, iccid, iccidSize);
 }
 
 int WioLTE::GetPhoneNumber(char* number, int numberSize)
 {
-	std::string response;
-	ArgumentParser parser;
-	std::string numberStr;
+	if (!_IdentityRead) ReadIdentity();
 
-	_AtSerial.WriteCommand("AT+CNUM");
-	while (true) {
-		if (!_AtSerial.ReadResponse("^(OK|\\+CNUM: .*)$", 500, &response)) return RET_ERR(-1, E_UNKNOWN);
-		if (response == "OK") break;
-
-		if (numberStr.size() >= 1) continue;
+	if (!_PhoneNumberRead) {
+		std::string response;
+		ArgumentParser parser;
 
-		parser.Parse(response.c_str());
-		if (parser.Size() < 2) return RET_ERR(-1, E_UNKNOWN);
-		numberStr = parser[1];
+		if (!ReadIdentityValue("AT+CNUM", PATTERNS_CNUM, &response)) return RET_ERR(-1, E_UNKNOWN);
+		if (response.size() >= 1) {
+			parser.Parse(response.c_str(), response.size());
+			if (parser.Size() < 2) return RET_ERR(-1, E_UNKNOWN);
+			_PhoneNumber.assign(parser.Pointer(1), parser.Length(1));
+		}
+		_PhoneNumberRead = true;
 	}
 
-	if ((int)numberStr.size() + 1 > numberSize) return RET_ERR(-1, E_UNKNOWN);
-	strcpy(number, numberStr.c_str());
-
-	return RET_OK((int)strlen(number));
+	return CopyIdentity(_PhoneNumber, number, numberSize);
 }
 
 int WioLTE::GetReceivedSignalStrength()
 {
-	std::string response;
-	ArgumentParser parser;
+	int rssi;
 
 	_AtSerial.WriteCommand("AT+CSQ");
-	if (!_AtSerial.ReadResponse("^\\+CSQ: (.*)$", 500, &response)) return RET_ERR(INT_MIN, E_UNKNOWN);
+	if (!_AtSerial.ReadResponse(FIELDS_CSQ, 500, &rssi, NULL)) return RET_ERR(INT_MIN, E_UNKNOWN);
 
-	parser.Parse(response.c_str());
-	if (parser.Size() != 2) return RET_ERR(INT_MIN, E_UNKNOWN);
-	int rssi = atoi(parser[0]);
-
-	if (!_AtSerial.ReadResponse("^OK$", 500, NULL)) return RET_ERR(INT_MIN, E_UNKNOWN);
+	if (!_AtSerial.ReadResponse(PATTERN_OK, 500, NULL)) return RET_ERR(INT_MIN, E_UNKNOWN);
 
 	if (rssi == 0) return RET_OK(-113);
 	else if (rssi == 1) return RET_OK(-111);
@@ -676,7 +1100,7 @@ bool WioLTE::GetTime(struct tm* tim)
 
 	_AtSerial.WriteCommand("AT+CCLK?");
 	if (!_AtSerial.ReadResponse("^\\+CCLK: (.*)$", 500, &response)) return RET_ERR(false, E_UNKNOWN);
-	if (!_AtSerial.ReadResponse("^OK$", 500, NULL)) return RET_ERR(false, E_UNKNOWN);
+	if (!_AtSerial.ReadResponse(PATTERN_OK, 500, NULL)) return RET_ERR(false, E_UNKNOWN);
 
 	if (strlen(response.c_str()) != 22) return RET_ERR(false, E_UNKNOWN);
 	const char* parameter = response.c_str();
@@ -708,15 +1132,17 @@ bool WioLTE::GetTime(struct tm* tim)
 
 bool WioLTE::SendSMS(const char* dialNumber, const char* message)
 {
-	if (!_AtSerial.WriteCommandAndReadResponse("AT+CMGF=1", "^OK$", 500, NULL)) return RET_ERR(false, E_UNKNOWN);
+	if (!_AtSerial.WriteCommandAndReadResponse("AT+CMGF=1", PATTERN_OK, 500, NULL)) return RET_ERR(false, E_UNKNOWN);
 
-	StringBuilder str;
-	if (!str.WriteFormat("AT+CMGS=\"%s\"", dialNumber)) return RET_ERR(false, E_UNKNOWN);
+	StringBuilder<COMMAND_SIZE> str;
+	str.Write("AT+CMGS=");
+	str.WriteQuoted(dialNumber);
+	if (str.IsOverflow()) return RET_ERR(false, E_UNKNOWN);
 	_AtSerial.WriteCommand(str.GetString());
 	if (!_AtSerial.ReadResponse("^> ", 500, NULL)) return RET_ERR(false, E_UNKNOWN);
 	_AtSerial.WriteBinary((const byte*)message, strlen(message));
 	_AtSerial.WriteBinary((const byte*)"\x1a", 1);
-	if (!_AtSerial.ReadResponse("^OK$", 120000, NULL)) return RET_ERR(false, E_UNKNOWN);
+	if (!_AtSerial.ReadResponse(PATTERN_OK, 120000, NULL)) return RET_ERR(false, E_UNKNOWN);
 
 	return RET_OK(true);
 }
@@ -727,10 +1153,12 @@ int WioLTE::ReceiveSMS(char* message, int messageSize, char* dialNumber, int dia
 	if (messageIndex == -2) return RET_OK(0);
 	if (messageIndex < 0) return RET_ERR(-1, E_UNKNOWN);
 
-	if (!_AtSerial.WriteCommandAndReadResponse("AT+CMGF=0", "^OK$", 500, NULL)) return RET_ERR(-1, E_UNKNOWN);
+	if (!_AtSerial.WriteCommandAndReadResponse("AT+CMGF=0", PATTERN_OK, 500, NULL)) return RET_ERR(-1, E_UNKNOWN);
 
-	StringBuilder str;
-	if (!str.WriteFormat("AT+CMGR=%d", messageIndex)) return RET_ERR(-1, E_UNKNOWN);
+	StringBuilder<NUMERIC_COMMAND_SIZE> str;
+	str.Write("AT+CMGR=");
+	str.WriteInt(messageIndex);
+	if (str.IsOverflow()) return RET_ERR(-1, E_UNKNOWN);
 	_AtSerial.WriteCommand(str.GetString());
 
 	if (!_AtSerial.ReadResponse("^\\+CMGR: .*$", 500, NULL)) return RET_ERR(-1, E_UNKNOWN);
@@ -796,7 +1224,7 @@ int WioLTE::ReceiveSMS(char* message, int messageSize, char* dialNumber, int dia
 	}
 	message[smSize] = '\0';
 
-	if (!_AtSerial.ReadResponse("^OK$", 500, NULL)) return RET_ERR(-1, E_UNKNOWN);
+	if (!_AtSerial.ReadResponse(PATTERN_OK, 500, NULL)) return RET_ERR(-1, E_UNKNOWN);
 
 	return RET_OK(smSize);
 }
@@ -807,17 +1235,21 @@ bool WioLTE::DeleteReceivedSMS()
 	if (messageIndex == -2) return RET_ERR(false, E_UNKNOWN);
 	if (messageIndex < 0) return RET_ERR(false, E_UNKNOWN);
 
-	StringBuilder str;
-	if (!str.WriteFormat("AT+CMGD=%d", messageIndex)) return RET_ERR(false, E_UNKNOWN);
-	if (!_AtSerial.WriteCommandAndReadResponse(str.GetString(), "^OK$", 500, NULL)) return RET_ERR(false, E_UNKNOWN);
+	StringBuilder<NUMERIC_COMMAND_SIZE> str;
+	str.Write("AT+CMGD=");
+	str.WriteInt(messageIndex);
+	if (str.IsOverflow()) return RET_ERR(false, E_UNKNOWN);
+	if (!_AtSerial.WriteCommandAndReadResponse(str.GetString(), PATTERN_OK, 500, NULL)) {
+		_ReceivedSMSIndex = -1;
+		return RET_ERR(false, E_UNKNOWN);
+	}
+	_ReceivedSMSIndex = _ReceivedSMSIndex == messageIndex ? -2 : -1;
 
 	return RET_OK(true);
 }
 
 bool WioLTE::WaitForCSRegistration(long timeout)
 {
-	std::string response;
-	ArgumentParser parser;
 
 	Stopwatch sw;
 	sw.Restart();
@@ -825,12 +1257,8 @@ bool WioLTE::WaitForCSRegistration(long timeout)
 		int status;
 
 		_AtSerial.WriteCommand("AT+CREG?");
-		if (!_AtSerial.ReadResponse("^\\+CREG: (.*)$", 500, &response)) return RET_ERR(false, E_UNKNOWN);
-		parser.Parse(response.c_str());
-		if (parser.Size() < 2) return RET_ERR(false, E_UNKNOWN);
-		//resultCode = atoi(parser[0]);
-		status = atoi(parser[1]);
-		if (!_AtSerial.ReadResponse("^OK$", 500, NULL)) return RET_ERR(false, E_UNKNOWN);
+		if (!_AtSerial.ReadResponse(FIELDS_CREG, 500, NULL, &status)) return RET_ERR(false, E_UNKNOWN);
+		if (!_AtSerial.ReadResponse(PATTERN_OK, 500, NULL)) return RET_ERR(false, E_UNKNOWN);
 		if (status == 0) return RET_ERR(false, E_UNKNOWN);
 		if (status == 1 || status == 5) break;
 
@@ -843,33 +1271,34 @@ bool WioLTE::WaitForCSRegistration(long timeout)
 
 bool WioLTE::WaitForPSRegistration(long timeout)
 {
-	std::string response;
-	ArgumentParser parser;
 
 	Stopwatch sw;
 	sw.Restart();
 	while (true) {
-		int status;
+		// Once read, the +CGREG/+CEREG URCs keep the state current.
+		while (_AtSerial.ReadUrc(0)) {}
+		if (_PacketGprsNetworkStat < 0 || _PacketEpsNetworkStat < 0) {
+			slre_cap caps[FIELDS_CGREG.CAPTURE_NUM];
+			int cgregStatus = -1;
+			int ceregStatus = -1;
+
+			_AtSerial.WriteCommand("AT+CGREG?;+CEREG?");
+			while (true) {
+				int index = _AtSerial.ReadResponse(PATTERNS_PS_REGISTRATION, 500, caps, FIELDS_CGREG.CAPTURE_NUM);
+				if (index < 0) return RET_ERR(false, E_UNKNOWN);
+				if (index == 0) break;
+				if (index == 1) FIELDS_CGREG.Decode(caps, NULL, &cgregStatus);
+				if (index == 2) FIELDS_CEREG.Decode(caps, NULL, &ceregStatus);
+			}
+			if (cgregStatus < 0 || ceregStatus < 0) return RET_ERR(false, E_UNKNOWN);
+			_PacketGprsNetworkStat = cgregStatus;
+			_PacketEpsNetworkStat = ceregStatus;
+		}
 
-		_AtSerial.WriteCommand("AT+CGREG?");
-		if (!_AtSerial.ReadResponse("^\\+CGREG: (.*)$", 500, &response)) return RET_ERR(false, E_UNKNOWN);
-		parser.Parse(response.c_str());
-		if (parser.Size() < 2) return RET_ERR(false, E_UNKNOWN);
-		//resultCode = atoi(parser[0]);
-		status = atoi(parser[1]);
-		if (!_AtSerial.ReadResponse("^OK$", 500, NULL)) return RET_ERR(false, E_UNKNOWN);
-		if (status == 0) return RET_ERR(false, E_UNKNOWN);
-		if (status == 1 || status == 5) break;
-
-		_AtSerial.WriteCommand("AT+CEREG?");
-		if (!_AtSerial.ReadResponse("^\\+CEREG: (.*)$", 500, &response)) return RET_ERR(false, E_UNKNOWN);
-		parser.Parse(response.c_str());
-		if (parser.Size() < 2) return RET_ERR(false, E_UNKNOWN);
-		//resultCode = atoi(parser[0]);
-		status = atoi(parser[1]);
-		if (!_AtSerial.ReadResponse("^OK$", 500, NULL)) return RET_ERR(false, E_UNKNOWN);
-		if (status == 0) return RET_ERR(false, E_UNKNOWN);
-		if (status == 1 || status == 5) break;
+		if (_PacketGprsNetworkStat == 0) return RET_ERR(false, E_UNKNOWN);
+		if (IsRegistered(_PacketGprsNetworkStat)) break;
+		if (_PacketEpsNetworkStat == 0) return RET_ERR(false, E_UNKNOWN);
+		if (IsRegistered(_PacketEpsNetworkStat)) break;
 
 		if (sw.ElapsedMilliseconds() >= (unsigned long)timeout) return RET_ERR(false, E_UNKNOWN);
 		_Delay(POLLING_INTERVAL);
@@ -880,14 +1309,20 @@ bool WioLTE::WaitForPSRegistration(long timeout)
 
 bool WioLTE::Activate(const char* accessPointName, const char* userName, const char* password, long waitForRegistTimeout)
 {
-	std::string response;
 	ArgumentParser parser;
 	Stopwatch sw;
 
 	if (!WaitForPSRegistration(0)) {
-		StringBuilder str;
-		if (!str.WriteFormat("AT+QICSGP=1,1,\"%s\",\"%s\",\"%s\",3", accessPointName, userName, password)) return RET_ERR(false, E_UNKNOWN);
-		if (!_AtSerial.WriteCommandAndReadResponse(str.GetString(), "^OK$", 500, NULL)) return RET_ERR(false, E_UNKNOWN);
+		StringBuilder<COMMAND_SIZE> str;
+		str.Write("AT+QICSGP=1,1,");
+		str.WriteQuoted(accessPointName);
+		str.Write(",");
+		str.WriteQuoted(userName);
+		str.Write(",");
+		str.WriteQuoted(password);
+		str.Write(",3");
+		if (str.IsOverflow()) return RET_ERR(false, E_UNKNOWN);
+		if (!_AtSerial.WriteCommandAndReadResponse(str.GetString(), PATTERN_OK, 500, NULL)) return RET_ERR(false, E_UNKNOWN);
 
 		sw.Restart();
 
@@ -899,25 +1334,26 @@ bool WioLTE::Activate(const char* accessPointName, const char* userName, const c
 		sprintf(dbg, "Elapsed time is %lu[msec.].", sw.ElapsedMilliseconds());
 		DEBUG_PRINTLN(dbg);
 
-		_AtSerial.WriteCommandAndReadResponse("AT+CREG?", "^OK$", 500, NULL);
-		_AtSerial.WriteCommandAndReadResponse("AT+CGREG?", "^OK$", 500, NULL);
-		_AtSerial.WriteCommandAndReadResponse("AT+CEREG?", "^OK$", 500, NULL);
+		_AtSerial.WriteCommandAndReadResponse("AT+CREG?", PATTERN_OK, 500, NULL);
+		_AtSerial.WriteCommandAndReadResponse("AT+CGREG?", PATTERN_OK, 500, NULL);
+		_AtSerial.WriteCommandAndReadResponse("AT+CEREG?", PATTERN_OK, 500, NULL);
 #endif // WIO_DEBUG
 	}
 
 	sw.Restart();
 	while (true) {
 		_AtSerial.WriteCommand("AT+QIACT=1");
-		if (!_AtSerial.ReadResponse("^(OK|ERROR)$", 150000, &response)) return RET_ERR(false, E_UNKNOWN);
-		if (response == "OK") break;
-		if (!_AtSerial.WriteCommandAndReadResponse("AT+QIGETERROR", "^OK$", 500, NULL)) return RET_ERR(false, E_UNKNOWN);
+		int index = _AtSerial.ReadResponse(PATTERNS_OK_OR_ERROR, 150000, NULL, 0);
+		if (index < 0) return RET_ERR(false, E_UNKNOWN);
+		if (index == 0) break;
+		if (!_AtSerial.WriteCommandAndReadResponse("AT+QIGETERROR", PATTERN_OK, 500, NULL)) return RET_ERR(false, E_UNKNOWN);
 		if (sw.ElapsedMilliseconds() >= 150000) return RET_ERR(false, E_UNKNOWN);
 		_Delay(POLLING_INTERVAL);
 	}
 
 	// for debug.
 #ifdef WIO_DEBUG
-	if (!_AtSerial.WriteCommandAndReadResponse("AT+QIACT?", "^OK$", 150000, NULL)) return RET_ERR(false, E_UNKNOWN);
+	if (!_AtSerial.WriteCommandAndReadResponse("AT+QIACT?", PATTERN_OK, 150000, NULL)) return RET_ERR(false, E_UNKNOWN);
 #endif // WIO_DEBUG
 
 	return RET_OK(true);
@@ -925,17 +1361,20 @@ bool WioLTE::Activate(const char* accessPointName, const char* userName, const c
 
 bool WioLTE::Deactivate()
 {
-	if (!_AtSerial.WriteCommandAndReadResponse("AT+QIDEACT=1", "^OK$", 40000, NULL)) return RET_ERR(false, E_UNKNOWN);
+	if (!_AtSerial.WriteCommandAndReadResponse("AT+QIDEACT=1", PATTERN_OK, 40000, NULL)) return RET_ERR(false, E_UNKNOWN);
+	for (int i = 0; i < CONNECT_ID_NUM; i++) FreeSocket(i);	// Deactivating closes every socket on the context.
 
 	return RET_OK(true);
 }
 
 bool WioLTE::SyncTime(const char* host)
 {
-	StringBuilder str;
+	StringBuilder<COMMAND_SIZE> str;
 	std::string response;
-	if (!str.WriteFormat("AT+QNTP=1,\"%s\"", host)) return RET_ERR(false, E_UNKNOWN);
-	if (!_AtSerial.WriteCommandAndReadResponse(str.GetString(), "^OK$", 500, NULL)) return RET_ERR(false, E_UNKNOWN);
+	str.Write("AT+QNTP=1,");
+	str.WriteQuoted(host);
+	if (str.IsOverflow()) return RET_ERR(false, E_UNKNOWN);
+	if (!_AtSerial.WriteCommandAndReadResponse(str.GetString(), PATTERN_OK, 500, NULL)) return RET_ERR(false, E_UNKNOWN);
 	if (!_AtSerial.ReadResponse("^\\+QNTP: (.*)$", 125000, &response)) return RET_ERR(false, E_UNKNOWN);
 	if (strncmp(response.c_str(), "0,", 2) != 0) return RET_ERR(-1, E_UNKNOWN); // check whether the command finished successfully
 
@@ -944,29 +1383,20 @@ bool WioLTE::SyncTime(const char* host)
 
 bool WioLTE::GetLocation(double* longitude, double* latitude)
 {
-	std::string response;
-	ArgumentParser parser;
+	slre_cap caps[FIELDS_QCELLLOC.CAPTURE_NUM];
 
-	if (!_AtSerial.WriteCommandAndReadResponse("AT+QLOCCFG=\"contextid\",1", "^OK$", 500, NULL)) return RET_ERR(false, E_UNKNOWN);
+	if (!_AtSerial.WriteCommandAndReadResponse("AT+QLOCCFG=\"contextid\",1", PATTERN_OK, 500, NULL)) return RET_ERR(false, E_UNKNOWN);
 
 	_AtSerial.WriteCommand("AT+QCELLLOC");
-	if (!_AtSerial.ReadResponse("^(\\+QCELLLOC: .*|\\+CME ERROR: .*)$", 60000, &response)) return RET_ERR(false, E_UNKNOWN);
-	if (strncmp(response.c_str(), "+QCELLLOC: ", 11) != 0) return RET_ERR(false, E_UNKNOWN);
-
-	parser.Parse(&response.c_str()[11]);
-	if (parser.Size() != 2) return RET_ERR(false, E_UNKNOWN);
-	*longitude = atof(parser[0]);
-	*latitude = atof(parser[1]);
-	if (!_AtSerial.ReadResponse("^OK$", 500, NULL)) return RET_ERR(false, E_UNKNOWN);
+	if (_AtSerial.ReadResponse(PATTERNS_QCELLLOC, 60000, caps, FIELDS_QCELLLOC.CAPTURE_NUM) != 0) return RET_ERR(false, E_UNKNOWN);
+	FIELDS_QCELLLOC.Decode(caps, longitude, latitude);
+	if (!_AtSerial.ReadResponse(PATTERN_OK, 500, NULL)) return RET_ERR(false, E_UNKNOWN);
 
 	return RET_OK(true);
 }
 
-int WioLTE::SocketOpen(const char* host, int port, SocketType type)
+int WioLTE::SocketOpenAsync(const char* host, int port, SocketType type)
 {
-	std::string response;
-	ArgumentParser parser;
-
 	if (host == NULL || host[0] == '\0') return RET_ERR(-1, E_UNKNOWN);
 	if (port < 0 || 65535 < port) return RET_ERR(-1, E_UNKNOWN);
 
@@ -982,74 +1412,238 @@ int WioLTE::SocketOpen(const char* host, int port, SocketType type)
 		return RET_ERR(-1, E_UNKNOWN);
 	}
 
-	bool connectIdUsed[CONNECT_ID_NUM];
-	for (int i = 0; i < CONNECT_ID_NUM; i++) connectIdUsed[i] = false;
-
-	_AtSerial.WriteCommand("AT+QISTATE?");
-	do {
-		if (!_AtSerial.ReadResponse("^(OK|\\+QISTATE: .*)$", 10000, &response)) return RET_ERR(-1, E_UNKNOWN);
-		if (strncmp(response.c_str(), "+QISTATE: ", 10) == 0) {
-			parser.Parse(&response.c_str()[10]);
-			if (parser.Size() >= 1) {
-				int connectId = atoi(parser[0]);
-				if (connectId < 0 || CONNECT_ID_NUM <= connectId) return RET_ERR(-1, E_UNKNOWN);
-				connectIdUsed[connectId] = true;
-			}
-		}
-	} while (response != "OK");
+	if (!_SocketTableSynced && !SyncSocketTable()) return RET_ERR(-1, GetResponseError());
 
 	int connectId;
 	for (connectId = 0; connectId < CONNECT_ID_NUM; connectId++) {
-		if (!connectIdUsed[connectId]) break;
+		if (_Sockets[connectId].State == SOCKET_FREE) break;
 	}
 	if (connectId >= CONNECT_ID_NUM) return RET_ERR(-1, E_UNKNOWN);
 
-	StringBuilder str;
-	if (!str.WriteFormat("AT+QIOPEN=1,%d,\"%s\",\"%s\",%d", connectId, typeStr, host, port)) return RET_ERR(-1, E_UNKNOWN);
-	if (!_AtSerial.WriteCommandAndReadResponse(str.GetString(), "^OK$", 150000, NULL)) return RET_ERR(-1, E_UNKNOWN);
-	str.Clear();
-	if (!str.WriteFormat("^\\+QIOPEN: %d,0$", connectId)) return RET_ERR(-1, E_UNKNOWN);
-	if (!_AtSerial.ReadResponse(str.GetString(), 150000, NULL)) return RET_ERR(-1, E_UNKNOWN);
+	SocketEntry& socket = _Sockets[connectId];
+	socket.State = SOCKET_OPENING;
+	socket.Type = type;
+	socket.OpenResult = -1;
+	socket.OpenRecorded = false;
+	socket.ReceivePending = false;
+	socket.OpenStopwatch.Restart();
+
+	StringBuilder<COMMAND_SIZE> str;
+	str.Write("AT+QIOPEN=1,");
+	str.WriteInt(connectId);
+	str.Write(",");
+	str.WriteQuoted(typeStr);
+	str.Write(",");
+	str.WriteQuoted(host);
+	str.Write(",");
+	str.WriteInt(port);
+	if (str.IsOverflow()) {
+		FreeSocket(connectId);
+		return RET_ERR(-1, E_UNKNOWN);
+	}
+	if (!_AtSerial.WriteCommandAndReadResponse(str.GetString(), PATTERN_OK, 150000, NULL)) {
+		// The module may hold the id after all (e.g. "socket identity has been used").
+		FreeSocket(connectId);
+		_SocketTableSynced = false;
+		return RET_ERR(-1, GetResponseError());
+	}
 
 	return RET_OK(connectId);
 }
 
-bool WioLTE::SocketSend(int connectId, const byte* data, int dataSize)
+int WioLTE::PollSocketOpen(int connectId)
+{
+	if (connectId < 0 || CONNECT_ID_NUM <= connectId) return RET_ERR(-1, E_UNKNOWN);
+
+	// The outcome arrives as +QIOPEN: <connectID>,<err>, and any <err> ends the wait.
+	SocketEntry& socket = _Sockets[connectId];
+	while (socket.State == SOCKET_OPENING && socket.OpenResult < 0 && _AtSerial.ReadUrc(0)) {}
+
+	if (socket.State == SOCKET_OPEN) return RET_OK(1);
+	if (socket.State == SOCKET_FREE) return RET_ERR(-1, E_UNKNOWN);
+	if (socket.State == SOCKET_CLOSED && socket.OpenResult == 0) return RET_ERR(-1, E_UNKNOWN);	// Opened, then closed. The caller closes it.
+
+	if (socket.State == SOCKET_OPENING && socket.OpenResult < 0) {
+		if (socket.OpenStopwatch.ElapsedMilliseconds() < SOCKET_OPEN_TIMEOUT) return RET_OK(0);
+		if (!socket.OpenRecorded) {
+			_AtSerial.GetStatistics()->Record("+QIOPEN", socket.OpenStopwatch.ElapsedMilliseconds(), true, false);
+			socket.OpenRecorded = true;
+		}
+		_SocketTableSynced = false;
+		return RET_ERR(-1, E_TIMEOUT);
+	}
+
+	// Failed, or closed by the peer or the network before it opened. The module keeps the socket until it is closed.
+	bool failed = socket.OpenResult > 0;
+	if (failed) _LastModuleError = socket.OpenResult;
+
+	StringBuilder<NUMERIC_COMMAND_SIZE> str;
+	str.Write("AT+QICLOSE=");
+	str.WriteInt(connectId);
+	if (!str.IsOverflow() && _AtSerial.WriteCommandAndReadResponse(str.GetString(), PATTERN_OK, 10000, NULL)) {
+		FreeSocket(connectId);
+	}
+	else {
+		_SocketTableSynced = false;
+	}
+
+	return RET_ERR(-1, failed ? E_MODULE_ERROR : E_UNKNOWN);
+}
+
+int WioLTE::SocketOpen(const char* host, int port, SocketType type)
 {
-	if (connectId >= CONNECT_ID_NUM) return RET_ERR(false, E_UNKNOWN);
-	if (dataSize > 1460) return RET_ERR(false, E_UNKNOWN);
+	int connectId = SocketOpenAsync(host, port, type);
+	if (connectId < 0) return -1;
+
+	int result;
+	while ((result = PollSocketOpen(connectId)) == 0) {
+		unsigned long elapsed = _Sockets[connectId].OpenStopwatch.ElapsedMilliseconds();
+		if (elapsed < SOCKET_OPEN_TIMEOUT) _AtSerial.ReadUrc(SOCKET_OPEN_TIMEOUT - elapsed);
+	}
+	if (result < 0) return -1;
+
+	return RET_OK(connectId);
+}
 
-	StringBuilder str;
-	if (!str.WriteFormat("AT+QISEND=%d,%d", connectId, dataSize)) return RET_ERR(false, E_UNKNOWN);
+bool WioLTE::SendSegment(int connectId, const byte* data, int dataSize)
+{
+	StringBuilder<NUMERIC_COMMAND_SIZE> str;
+	str.Write("AT+QISEND=");
+	str.WriteInt(connectId);
+	str.Write(",");
+	str.WriteInt(dataSize);
+	if (str.IsOverflow()) return RET_ERR(false, E_UNKNOWN);
 	_AtSerial.WriteCommand(str.GetString());
-	if (!_AtSerial.ReadResponse("^>", 500, NULL)) return RET_ERR(false, E_UNKNOWN);
+	if (!_AtSerial.ReadResponse("^> ", 500, NULL)) return RET_ERR(false, GetResponseError());
 	_AtSerial.WriteBinary(data, dataSize);
-	if (!_AtSerial.ReadResponse("^SEND OK$", 5000, NULL)) return RET_ERR(false, E_UNKNOWN);
+	int index = _AtSerial.ReadResponse(PATTERNS_SEND, 5000, NULL, 0);
+	if (index < 0) return RET_ERR(false, GetResponseError());
+	if (index != 0) return RET_ERR(false, E_SEND_FAILED);
 
 	return RET_OK(true);
 }
 
+int WioLTE::SocketWrite(int connectId, const byte* data, int dataSize)
+{
+	if (connectId < 0 || CONNECT_ID_NUM <= connectId) return RET_ERR(-1, E_UNKNOWN);
+	if (dataSize < 0) return RET_ERR(-1, E_UNKNOWN);
+	// A datagram cannot be split.
+	if (_Sockets[connectId].Type == SOCKET_UDP && dataSize > SOCKET_SEND_SEGMENT_SIZE) return RET_ERR(-1, E_UNKNOWN);
+
+	// SEND OK only means the module has buffered the data, so with a window the unacknowledged bytes are kept below it.
+	// They are estimated locally and asked for only when the estimate would exceed the window.
+	bool windowed = _SocketSendWindow >= 1 && _Sockets[connectId].Type == SOCKET_TCP;
+	int unackedSize = -1;
+
+	// The next AT+QISEND cannot be issued before SEND OK, its final result.
+	int sentSize = 0;
+	while (sentSize < dataSize) {
+		int segmentSize = dataSize - sentSize < SOCKET_SEND_SEGMENT_SIZE ? dataSize - sentSize : SOCKET_SEND_SEGMENT_SIZE;
+
+		if (windowed && (unackedSize < 0 || unackedSize + segmentSize > _SocketSendWindow)) {
+			Stopwatch sw;
+			sw.Restart();
+			while (true) {
+				int lastUnackedSize = unackedSize;
+				if (!GetSocketSendState(connectId, NULL, NULL, &unackedSize)) return sentSize;
+				if (unackedSize <= 0 || unackedSize + segmentSize <= _SocketSendWindow) break;
+
+				// A slow peer that is still acknowledging is not timed out.
+				if (lastUnackedSize >= 0 && unackedSize < lastUnackedSize) sw.Restart();
+				if (sw.ElapsedMilliseconds() >= SOCKET_SEND_WINDOW_TIMEOUT) return RET_ERR(sentSize, E_TIMEOUT);
+				_Delay(POLLING_INTERVAL);
+			}
+		}
+
+		if (!SendSegment(connectId, &data[sentSize], segmentSize)) return sentSize;
+		sentSize += segmentSize;
+		if (windowed) unackedSize += segmentSize;
+	}
+
+	return RET_OK(sentSize);
+}
+
+bool WioLTE::GetSocketSendState(int connectId, int* sentSize, int* ackedSize, int* unackedSize)
+{
+	if (connectId < 0 || CONNECT_ID_NUM <= connectId) return RET_ERR(false, E_UNKNOWN);
+
+	StringBuilder<NUMERIC_COMMAND_SIZE> str;
+	str.Write("AT+QISEND=");
+	str.WriteInt(connectId);
+	str.Write(",0");
+	if (str.IsOverflow()) return RET_ERR(false, E_UNKNOWN);
+	_AtSerial.WriteCommand(str.GetString());
+	if (!_AtSerial.ReadResponse(FIELDS_QISEND, 500, sentSize, ackedSize, unackedSize)) return RET_ERR(false, GetResponseError());
+	if (!_AtSerial.ReadResponse(PATTERN_OK, 500, NULL)) return RET_ERR(false, E_UNKNOWN);
+
+	return RET_OK(true);
+}
+
+bool WioLTE::SocketSend(int connectId, const byte* data, int dataSize)
+{
+	if (dataSize < 0) return RET_ERR(false, E_UNKNOWN);	// SocketWrite() would return -1, equal to it.
+
+	return SocketWrite(connectId, data, dataSize) == dataSize;
+}
+
 bool WioLTE::SocketSend(int connectId, const char* data)
 {
 	return SocketSend(connectId, (const byte*)data, strlen(data));
 }
 
+int WioLTE::SocketPoll(const int* connectIds, int* events, int connectIdNum, long timeout)
+{
+	if (connectIdNum < 0) return RET_ERR(-1, E_UNKNOWN);
+	for (int i = 0; i < connectIdNum; i++) {
+		if (connectIds[i] < 0 || CONNECT_ID_NUM <= connectIds[i]) return RET_ERR(-1, E_UNKNOWN);
+	}
+
+	// Events come from URCs. A missed +QIURC: "recv" is caught by one query, and only when nothing is ready yet.
+	int eventNum = GetSocketEvents(connectIds, events, connectIdNum);
+	if (eventNum <= 0) {
+		if (!QuerySocketUnread(connectIds, connectIdNum)) return RET_ERR(-1, GetResponseError());
+		eventNum = GetSocketEvents(connectIds, events, connectIdNum);
+	}
+
+	Stopwatch sw;
+	sw.Restart();
+	while (eventNum <= 0) {
+		unsigned long elapsed = sw.ElapsedMilliseconds();
+		if (elapsed >= (unsigned long)timeout) break;
+		_AtSerial.ReadUrc(timeout - elapsed);
+		eventNum = GetSocketEvents(connectIds, events, connectIdNum);
+	}
+
+	return RET_OK(eventNum);
+}
+
 int WioLTE::SocketReceive(int connectId, byte* data, int dataSize)
 {
-	std::string response;
+	slre_cap cap;
 
-	if (connectId >= CONNECT_ID_NUM) return RET_ERR(-1, E_UNKNOWN);
+	if (connectId < 0 || CONNECT_ID_NUM <= connectId) return RET_ERR(-1, E_UNKNOWN);
+
+	// Cleared before the command so that a +QIURC: "recv" arriving during the exchange is kept.
+	_Sockets[connectId].ReceivePending = false;
+
+	int readSize = dataSize < RECEIVE_SIZE_MAX ? dataSize : RECEIVE_SIZE_MAX;
+	if (readSize <= 0) return RET_ERR(-1, E_UNKNOWN);
 
-	StringBuilder str;
-	if (!str.WriteFormat("AT+QIRD=%d", connectId)) return RET_ERR(-1, E_UNKNOWN);
+	StringBuilder<NUMERIC_COMMAND_SIZE> str;
+	str.Write("AT+QIRD=");
+	str.WriteInt(connectId);
+	str.Write(",");
+	str.WriteInt(readSize);
+	if (str.IsOverflow()) return RET_ERR(-1, E_UNKNOWN);
 	_AtSerial.WriteCommand(str.GetString());
-	if (!_AtSerial.ReadResponse("^\\+QIRD: (.*)$", 500, &response)) return RET_ERR(-1, E_UNKNOWN);
-	int dataLength = atoi(response.c_str());
+	if (!_AtSerial.ReadResponse("^\\+QIRD: (.*)$", 500, &cap, 1)) return RET_ERR(-1, GetResponseError());
+	int dataLength = atoi(cap.ptr);
 	if (dataLength >= 1) {
-		if (dataLength > dataSize) return RET_ERR(-1, E_UNKNOWN);
+		if (dataLength > readSize) return RET_ERR(-1, E_UNKNOWN);
 		if (!_AtSerial.ReadBinary(data, dataLength, 500)) return RET_ERR(-1, E_UNKNOWN);
+		if (dataLength == readSize) _Sockets[connectId].ReceivePending = true;	// The modem may hold more.
 	}
-	if (!_AtSerial.ReadResponse("^OK$", 500, NULL)) return RET_ERR(-1, E_UNKNOWN);
+	if (!_AtSerial.ReadResponse(PATTERN_OK, 500, NULL)) return RET_ERR(-1, E_UNKNOWN);
 
 	return RET_OK(dataLength);
 }
@@ -1068,31 +1662,42 @@ int WioLTE::SocketReceive(int connectId, byte* data, int dataSize, long timeout)
 	sw.Restart();
 	int dataLength;
 	while ((dataLength = SocketReceive(connectId, data, dataSize)) == 0) {
-		if (sw.ElapsedMilliseconds() >= (unsigned long)timeout) return 0;
-		_Delay(POLLING_INTERVAL);
+		if (_Sockets[connectId].State == SOCKET_CLOSED) return 0;
+
+		// Wait for +QIURC: "recv" instead of polling AT+QIRD.
+		Stopwatch urcSw;
+		urcSw.Restart();
+		while (!_Sockets[connectId].ReceivePending && _Sockets[connectId].State != SOCKET_CLOSED) {
+			unsigned long elapsed = sw.ElapsedMilliseconds();
+			if (elapsed >= (unsigned long)timeout) return 0;
+			if (urcSw.ElapsedMilliseconds() >= RECEIVE_URC_WAIT_MAX) break;
+
+			unsigned long wait = timeout - elapsed;
+			if (wait > RECEIVE_URC_WAIT_MAX) wait = RECEIVE_URC_WAIT_MAX;
+			_AtSerial.ReadUrc(wait);
+		}
 	}
 	return dataLength;
 }
 
 int WioLTE::SocketReceive(int connectId, char* data, int dataSize, long timeout)
 {
-	Stopwatch sw;
-	sw.Restart();
-	int dataLength;
-	while ((dataLength = SocketReceive(connectId, data, dataSize)) == 0) {
-		if (sw.ElapsedMilliseconds() >= (unsigned long)timeout) return 0;
-		_Delay(POLLING_INTERVAL);
-	}
+	int dataLength = SocketReceive(connectId, (byte*)data, dataSize - 1, timeout);
+	if (dataLength >= 0) data[dataLength] = '\0';
+
 	return dataLength;
 }
 
 bool WioLTE::SocketClose(int connectId)
 {
-	if (connectId >= CONNECT_ID_NUM) return RET_ERR(false, E_UNKNOWN);
+	if (connectId < 0 || CONNECT_ID_NUM <= connectId) return RET_ERR(false, E_UNKNOWN);
 
-	StringBuilder str;
-	if (!str.WriteFormat("AT+QICLOSE=%d", connectId)) return RET_ERR(false, E_UNKNOWN);
-	if (!_AtSerial.WriteCommandAndReadResponse(str.GetString(), "^OK$", 10000, NULL)) return RET_ERR(false, E_UNKNOWN);
+	StringBuilder<NUMERIC_COMMAND_SIZE> str;
+	str.Write("AT+QICLOSE=");
+	str.WriteInt(connectId);
+	if (str.IsOverflow()) return RET_ERR(false, E_UNKNOWN);
+	if (!_AtSerial.WriteCommandAndReadResponse(str.GetString(), PATTERN_OK, 10000, NULL)) return RET_ERR(false, GetResponseError());
+	FreeSocket(connectId);
 
 	return RET_OK(true);
 }
@@ -1109,20 +1714,19 @@ int WioLTE::HttpGet(const char* url, char* data, int dataSize, long timeout)
 
 int WioLTE::HttpGet(const char* url, char* data, int dataSize, const WioLTEHttpHeader& header, long timeout)
 {
-	std::string response;
-	ArgumentParser parser;
+	slre_cap caps[FIELDS_QHTTPGET.CAPTURE_NUM];
 
 	int timeoutSec = timeout / 1000;
 	if (timeout % 1000 > 0) timeoutSec++;
 
 	if (strncmp(url, "https:", 6) == 0) {
-		if (!_AtSerial.WriteCommandAndReadResponse("AT+QHTTPCFG=\"sslctxid\",1"         , "^OK$", 500, NULL)) return RET_ERR(-1, E_UNKNOWN);
-		if (!_AtSerial.WriteCommandAndReadResponse("AT+QSSLCFG=\"sslversion\",1,4"      , "^OK$", 500, NULL)) return RET_ERR(-1, E_UNKNOWN);
-		if (!_AtSerial.WriteCommandAndReadResponse("AT+QSSLCFG=\"ciphersuite\",1,0XFFFF", "^OK$", 500, NULL)) return RET_ERR(-1, E_UNKNOWN);
-		if (!_AtSerial.WriteCommandAndReadResponse("AT+QSSLCFG=\"seclevel\",1,0"        , "^OK$", 500, NULL)) return RET_ERR(-1, E_UNKNOWN);
+		if (!_AtSerial.WriteCommandAndReadResponse("AT+QHTTPCFG=\"sslctxid\",1"         , PATTERN_OK, 500, NULL)) return RET_ERR(-1, E_UNKNOWN);
+		if (!_AtSerial.WriteCommandAndReadResponse("AT+QSSLCFG=\"sslversion\",1,4"      , PATTERN_OK, 500, NULL)) return RET_ERR(-1, E_UNKNOWN);
+		if (!_AtSerial.WriteCommandAndReadResponse("AT+QSSLCFG=\"ciphersuite\",1,0XFFFF", PATTERN_OK, 500, NULL)) return RET_ERR(-1, E_UNKNOWN);
+		if (!_AtSerial.WriteCommandAndReadResponse("AT+QSSLCFG=\"seclevel\",1,0"        , PATTERN_OK, 500, NULL)) return RET_ERR(-1, E_UNKNOWN);
 	}
 
-	if (!_AtSerial.WriteCommandAndReadResponse("AT+QHTTPCFG=\"requestheader\",1", "^OK$", 500, NULL)) return RET_ERR(-1, E_UNKNOWN);
+	if (!_AtSerial.WriteCommandAndReadResponse("AT+QHTTPCFG=\"requestheader\",1", PATTERN_OK, 500, NULL)) return RET_ERR(-1, E_UNKNOWN);
 
 	if (!HttpSetUrl(url)) return RET_ERR(-1, E_UNKNOWN);
 
@@ -1132,51 +1736,61 @@ int WioLTE::HttpGet(const char* url, char* data, int dataSize, const WioLTEHttpH
 	int uriLength;
 	if (!SplitUrl(url, &host, &hostLength, &uri, &uriLength)) return RET_ERR(false, E_UNKNOWN);
 
-	StringBuilder headerSb;
-	headerSb.Write("GET ");
+	std::string headerStr;
+	headerStr += "GET ";
 	if (uriLength <= 0) {
-		headerSb.Write("/");
+		headerStr += "/";
 	}
 	else {
-		headerSb.Write(uri, uriLength);
+		headerStr.append(uri, uriLength);
 	}
-	headerSb.Write(" HTTP/1.1\r\n");
-	headerSb.Write("Host: ");
-	headerSb.Write(host, hostLength);
-	headerSb.Write("\r\n");
+	headerStr += " HTTP/1.1\r\n";
+	headerStr += "Host: ";
+	headerStr.append(host, hostLength);
+	headerStr += "\r\n";
 	for (auto it = header.begin(); it != header.end(); it++) {
-		headerSb.Write(it->first.c_str());
-		headerSb.Write(": ");
-		headerSb.Write(it->second.c_str());
-		headerSb.Write("\r\n");
+		headerStr += it->first.c_str();
+		headerStr += ": ";
+		headerStr += it->second.c_str();
+		headerStr += "\r\n";
 	}
-	headerSb.Write("\r\n");
+	headerStr += "\r\n";
 	DEBUG_PRINTLN("=== header");
-	DEBUG_PRINTLN(headerSb.GetString());
+	DEBUG_PRINTLN(headerStr.c_str());
 	DEBUG_PRINTLN("===");
 
-	StringBuilder str;
-	if (!str.WriteFormat("AT+QHTTPGET=%d,%d", timeoutSec, headerSb.Length())) return RET_ERR(false, E_UNKNOWN);
+	StringBuilder<NUMERIC_COMMAND_SIZE> str;
+	str.Write("AT+QHTTPGET=");
+	str.WriteInt(timeoutSec);
+	str.Write(",");
+	str.WriteInt(headerStr.size());
+	if (str.IsOverflow()) return RET_ERR(-1, E_UNKNOWN);
 	_AtSerial.WriteCommand(str.GetString());
-	if (!_AtSerial.ReadResponse("^CONNECT$", 60000, NULL)) return RET_ERR(false, E_UNKNOWN);
-	const char* headerStr = headerSb.GetString();
-	_AtSerial.WriteBinary((const byte*)headerStr, strlen(headerStr));
-	if (!_AtSerial.ReadResponse("^OK$", 1000, NULL)) return RET_ERR(false, E_UNKNOWN);
-	if (!_AtSerial.ReadResponse("^\\+QHTTPGET: (.*)$", (timeoutSec + 1) * 1000, &response)) return RET_ERR(-1, E_UNKNOWN);
-
-	parser.Parse(response.c_str());
-	if (parser.Size() < 1) return RET_ERR(-1, E_UNKNOWN);
-	if (strcmp(parser[0], "0") != 0) return RET_ERR(-1, E_UNKNOWN);
-	int contentLength = parser.Size() >= 3 ? atoi(parser[2]) : -1;
+	if (!_AtSerial.ReadResponse(PATTERN_CONNECT, 60000, NULL)) return RET_ERR(false, E_UNKNOWN);
+	_AtSerial.WriteBinary((const byte*)headerStr.data(), headerStr.size());
+	if (!_AtSerial.ReadResponse(PATTERN_OK, 1000, NULL)) return RET_ERR(false, E_UNKNOWN);
+	int err;
+	int contentLength = -1;
+	switch (_AtSerial.ReadResponse(PATTERNS_QHTTPGET, (timeoutSec + 1) * 1000, caps, FIELDS_QHTTPGET.CAPTURE_NUM)) {
+	case 0:
+		FIELDS_QHTTPGET.Decode(caps, &err, NULL, &contentLength);
+		break;
+	case 1:
+		FIELDS_QHTTPGET_ERROR.Decode(caps, &err);
+		break;
+	default:
+		return RET_ERR(-1, E_UNKNOWN);
+	}
+	if (err != 0) return RET_ERR(-1, E_UNKNOWN);
 
 	_AtSerial.WriteCommand("AT+QHTTPREAD");
-	if (!_AtSerial.ReadResponse("^CONNECT$", 1000, NULL)) return RET_ERR(-1, E_UNKNOWN);
+	if (!_AtSerial.ReadResponse(PATTERN_CONNECT, 1000, NULL)) return RET_ERR(-1, E_UNKNOWN);
 	if (contentLength >= 0) {
 		if (contentLength + 1 > dataSize) return RET_ERR(-1, E_UNKNOWN);
 		if (!_AtSerial.ReadBinary((byte*)data, contentLength, 60000)) return RET_ERR(-1, E_UNKNOWN);
 		data[contentLength] = '\0';
 
-		if (!_AtSerial.ReadResponse("^OK$", 1000, NULL)) return RET_ERR(-1, E_UNKNOWN);
+		if (!_AtSerial.ReadResponse(PATTERN_OK, 1000, NULL)) return RET_ERR(-1, E_UNKNOWN);
 	}
 	else {
 		if (!_AtSerial.ReadResponseQHTTPREAD(data, dataSize, 60000)) return RET_ERR(-1, E_UNKNOWN);
@@ -1200,20 +1814,19 @@ bool WioLTE::HttpPost(const char* url, const char* data, int* responseCode, long
 
 bool WioLTE::HttpPost(const char* url, const char* data, int* responseCode, const WioLTEHttpHeader& header, long timeout)
 {
-	std::string response;
-	ArgumentParser parser;
+	slre_cap caps[FIELDS_QHTTPPOST.CAPTURE_NUM];
 
 	int timeoutSec = timeout / 1000;
 	if (timeout % 1000 > 0) timeoutSec++;
 
 	if (strncmp(url, "https:", 6) == 0) {
-		if (!_AtSerial.WriteCommandAndReadResponse("AT+QHTTPCFG=\"sslctxid\",1"         , "^OK$", 500, NULL)) return RET_ERR(false, E_UNKNOWN);
-		if (!_AtSerial.WriteCommandAndReadResponse("AT+QSSLCFG=\"sslversion\",1,4"      , "^OK$", 500, NULL)) return RET_ERR(false, E_UNKNOWN);
-		if (!_AtSerial.WriteCommandAndReadResponse("AT+QSSLCFG=\"ciphersuite\",1,0XFFFF", "^OK$", 500, NULL)) return RET_ERR(false, E_UNKNOWN);
-		if (!_AtSerial.WriteCommandAndReadResponse("AT+QSSLCFG=\"seclevel\",1,0"        , "^OK$", 500, NULL)) return RET_ERR(false, E_UNKNOWN);
+		if (!_AtSerial.WriteCommandAndReadResponse("AT+QHTTPCFG=\"sslctxid\",1"         , PATTERN_OK, 500, NULL)) return RET_ERR(false, E_UNKNOWN);
+		if (!_AtSerial.WriteCommandAndReadResponse("AT+QSSLCFG=\"sslversion\",1,4"      , PATTERN_OK, 500, NULL)) return RET_ERR(false, E_UNKNOWN);
+		if (!_AtSerial.WriteCommandAndReadResponse("AT+QSSLCFG=\"ciphersuite\",1,0XFFFF", PATTERN_OK, 500, NULL)) return RET_ERR(false, E_UNKNOWN);
+		if (!_AtSerial.WriteCommandAndReadResponse("AT+QSSLCFG=\"seclevel\",1,0"        , PATTERN_OK, 500, NULL)) return RET_ERR(false, E_UNKNOWN);
 	}
 
-	if (!_AtSerial.WriteCommandAndReadResponse("AT+QHTTPCFG=\"requestheader\",1", "^OK$", 500, NULL)) return RET_ERR(false, E_UNKNOWN);
+	if (!_AtSerial.WriteCommandAndReadResponse("AT+QHTTPCFG=\"requestheader\",1", PATTERN_OK, 500, NULL)) return RET_ERR(false, E_UNKNOWN);
 
 	if (!HttpSetUrl(url)) return RET_ERR(false, E_UNKNOWN);
 
@@ -1223,62 +1836,74 @@ bool WioLTE::HttpPost(const char* url, const char* data, int* responseCode, cons
 	int uriLength;
 	if (!SplitUrl(url, &host, &hostLength, &uri, &uriLength)) return RET_ERR(false, E_UNKNOWN);
 
-	StringBuilder headerSb;
-	headerSb.Write("POST ");
+	std::string headerStr;
+	headerStr += "POST ";
 	if (uriLength <= 0) {
-		headerSb.Write("/");
+		headerStr += "/";
 	}
 	else {
-		headerSb.Write(uri, uriLength);
+		headerStr.append(uri, uriLength);
 	}
-	headerSb.Write(" HTTP/1.1\r\n");
-	headerSb.Write("Host: ");
-	headerSb.Write(host, hostLength);
-	headerSb.Write("\r\n");
-	if (!headerSb.WriteFormat("Content-Length: %d\r\n", strlen(data))) return RET_ERR(false, E_UNKNOWN);
+	headerStr += " HTTP/1.1\r\n";
+	headerStr += "Host: ";
+	headerStr.append(host, hostLength);
+	headerStr += "\r\n";
+	StringBuilder<NUMERIC_COMMAND_SIZE> contentLength;
+	contentLength.WriteInt(strlen(data));
+	if (contentLength.IsOverflow()) return RET_ERR(false, E_UNKNOWN);
+	headerStr += "Content-Length: ";
+	headerStr += contentLength.GetString();
+	headerStr += "\r\n";
 	for (auto it = header.begin(); it != header.end(); it++) {
-		headerSb.Write(it->first.c_str());
-		headerSb.Write(": ");
-		headerSb.Write(it->second.c_str());
-		headerSb.Write("\r\n");
+		headerStr += it->first.c_str();
+		headerStr += ": ";
+		headerStr += it->second.c_str();
+		headerStr += "\r\n";
 	}
-	headerSb.Write("\r\n");
+	headerStr += "\r\n";
 	DEBUG_PRINTLN("=== header");
-	DEBUG_PRINTLN(headerSb.GetString());
+	DEBUG_PRINTLN(headerStr.c_str());
 	DEBUG_PRINTLN("===");
 
-	StringBuilder str;
-	if (!str.WriteFormat("AT+QHTTPPOST=%d,%d,%d", headerSb.Length() + strlen(data), timeoutSec, timeoutSec)) return RET_ERR(false, E_UNKNOWN);
+	StringBuilder<NUMERIC_COMMAND_SIZE> str;
+	str.Write("AT+QHTTPPOST=");
+	str.WriteInt(headerStr.size() + strlen(data));
+	str.Write(",");
+	str.WriteInt(timeoutSec);
+	str.Write(",");
+	str.WriteInt(timeoutSec);
+	if (str.IsOverflow()) return RET_ERR(false, E_UNKNOWN);
 	_AtSerial.WriteCommand(str.GetString());
-	if (!_AtSerial.ReadResponse("^CONNECT$", 60000, NULL)) return RET_ERR(false, E_UNKNOWN);
-	const char* headerStr = headerSb.GetString();
-	_AtSerial.WriteBinary((const byte*)headerStr, strlen(headerStr));
+	if (!_AtSerial.ReadResponse(PATTERN_CONNECT, 60000, NULL)) return RET_ERR(false, E_UNKNOWN);
+	_AtSerial.WriteBinary((const byte*)headerStr.data(), headerStr.size());
 	_AtSerial.WriteBinary((const byte*)data, strlen(data));
-	if (!_AtSerial.ReadResponse("^OK$", 1000, NULL)) return RET_ERR(false, E_UNKNOWN);
-	if (!_AtSerial.ReadResponse("^\\+QHTTPPOST: (.*)$", (timeoutSec + 1) * 1000, &response)) return RET_ERR(false, E_UNKNOWN);
-	parser.Parse(response.c_str());
-	if (parser.Size() < 1) return RET_ERR(false, E_UNKNOWN);
-	if (strcmp(parser[0], "0") != 0) return RET_ERR(false, E_UNKNOWN);
-	if (parser.Size() < 2) {
-		*responseCode = -1;
-	}
-	else {
-		*responseCode = atoi(parser[1]);
+	if (!_AtSerial.ReadResponse(PATTERN_OK, 1000, NULL)) return RET_ERR(false, E_UNKNOWN);
+	int err;
+	*responseCode = -1;
+	switch (_AtSerial.ReadResponse(PATTERNS_QHTTPPOST, (timeoutSec + 1) * 1000, caps, FIELDS_QHTTPPOST.CAPTURE_NUM)) {
+	case 0:
+		FIELDS_QHTTPPOST.Decode(caps, &err, responseCode);
+		break;
+	case 1:
+		FIELDS_QHTTPPOST_ERROR.Decode(caps, &err);
+		break;
+	default:
+		return RET_ERR(false, E_UNKNOWN);
 	}
+	if (err != 0) return RET_ERR(false, E_UNKNOWN);
 
 	return RET_OK(true);
 }
 
 bool WioLTE::EnableGNSS(long timeout)
 {
-	std::string response;
-
 	Stopwatch sw;
 	sw.Restart();
 	while (true) {
 		_AtSerial.WriteCommand("AT+QGPS=1");
-		if (!_AtSerial.ReadResponse("^(OK|ERROR)$", 500, &response)) return RET_ERR(false, E_TIMEOUT);
-		if (response == "OK") break;
+		int index = _AtSerial.ReadResponse(PATTERNS_OK_OR_ERROR, 500, NULL, 0);
+		if (index < 0) return RET_ERR(false, _AtSerial.IsErrorResponse() ? GetResponseError() : E_TIMEOUT);
+		if (index == 0) break;
 		if (sw.ElapsedMilliseconds() >= (unsigned long)timeout) return RET_ERR(false, E_UNKNOWN);
 		_Delay(POLLING_INTERVAL);
 	}
@@ -1288,91 +1913,78 @@ bool WioLTE::EnableGNSS(long timeout)
 
 bool WioLTE::DisableGNSS()
 {
-	if (!_AtSerial.WriteCommandAndReadResponse("AT+QGPSEND", "^OK$", 500, NULL)) return RET_ERR(false, E_TIMEOUT);
+	if (!_AtSerial.WriteCommandAndReadResponse("AT+QGPSEND", PATTERN_OK, 500, NULL)) return RET_ERR(false, _AtSerial.IsErrorResponse() ? GetResponseError() : E_TIMEOUT);
 
 	return RET_OK(true);
 }
 
 bool WioLTE::GetGNSSLocation(double* longitude, double* latitude, double* altitude, struct tm* tim)
 {
-	std::string response;
-	std::string locStr;
+	slre_cap caps[FIELDS_QGPSLOC.CAPTURE_NUM];
+	bool located = false;
 
 	_AtSerial.WriteCommand("AT+QGPSLOC?");
 	while (true) {
-		if (!_AtSerial.ReadResponse("^(OK|\\+QGPSLOC: .*|\\+CME ERROR: .*)$", 500, &response)) return RET_ERR(false, E_TIMEOUT);
-		if (response == "OK") break;
-		if (strncmp(response.c_str(), "+CME ERROR: ", 12) == 0) {
-			if (strcmp(&response.c_str()[12], "516") == 0) {	// Not fixed now
+		int index = _AtSerial.ReadResponse(PATTERNS_QGPSLOC, 500, caps, FIELDS_QGPSLOC.CAPTURE_NUM);
+		if (index < 0) return RET_ERR(false, E_TIMEOUT);
+		if (index == 0) break;
+		if (index == 2) {
+			if (atoi(caps[0].ptr) == 516) {	// Not fixed now
 				return RET_ERR(false, E_GNSS_NOT_FIXED);
 			}
 			else {
 				return RET_ERR(false, E_UNKNOWN);
 			}
 		}
-		locStr = response;
-	}
-
-	// parse the response: utc time, latitude, longitude, horizontal precision, altitude
-	if (strlen(locStr.c_str()) < 10) return RET_ERR(false, E_UNKNOWN);
-	ArgumentParser parser;
-	parser.Parse(&locStr.c_str()[10]);
-	if (parser.Size() < 5) return RET_ERR(false, E_UNKNOWN);
-
-	// latitude
-	if (latitude != NULL) {
-		*latitude = GnssCoordinateToDecimal(atof(parser[1]));
-
-		if (parser[1][strlen(parser[1]) - 1] != 'N') {
-			*latitude = - *latitude;
+		if (located) continue;
+
+		// The fields are views into the line buffer, so they are decoded before reading OK.
+		AtString utc;
+		AtString lat;
+		AtString lon;
+		double alt;
+		AtString date;
+		FIELDS_QGPSLOC.Decode(caps, &utc, &lat, &lon, NULL, &alt, NULL, NULL, NULL, NULL, &date);
+		if (lat.Length < 1 || lon.Length < 1) continue;
+
+		// latitude
+		if (latitude != NULL) {
+			*latitude = GnssCoordinateToDecimal(atof(lat.Ptr));
+
+			if (lat.Ptr[lat.Length - 1] != 'N') {
+				*latitude = - *latitude;
+			}
 		}
-	}
 
-	// longitude
-	if (longitude != NULL) {
-		*longitude = GnssCoordinateToDecimal(atof(parser[2]));
+		// longitude
+		if (longitude != NULL) {
+			*longitude = GnssCoordinateToDecimal(atof(lon.Ptr));
 
-		if (parser[2][strlen(parser[2]) - 1] != 'E') {
-			*longitude = - *longitude;
+			if (lon.Ptr[lon.Length - 1] != 'E') {
+				*longitude = - *longitude;
+			}
 		}
-	}
 
-	// altitude
-	if (altitude != NULL) {
-		*altitude = atof(parser[4]);
-	}
-
-	// utc time
-	if (tim != NULL) {
-		if (parser.Size() < 10) return RET_ERR(false, E_UNKNOWN);
-
-		const char* ymd = parser[9];	// date. ddmmyy
-		const char* hms = parser[0];	// time. hhmmss.s
-
-		if (strlen(ymd) != 6) return RET_ERR(false, E_UNKNOWN);
-		if (strlen(hms) < 6) return RET_ERR(false, E_UNKNOWN);
+		// altitude
+		if (altitude != NULL) {
+			*altitude = alt;
+		}
 
-		int yearOffset = Convert2DigitsToInt(&ymd[4]);
-		tim->tm_year = (yearOffset >= 80 ? 1900 : 2000) + yearOffset - 1900;
-		tim->tm_mon = Convert2DigitsToInt(&ymd[2]) - 1;
-		tim->tm_mday = Convert2DigitsToInt(&ymd[0]);
-		tim->tm_hour = Convert2DigitsToInt(&hms[0]);
-		tim->tm_min = Convert2DigitsToInt(&hms[2]);
-		tim->tm_sec = Convert2DigitsToInt(&hms[4]);
-		tim->tm_wday = 0;
-		tim->tm_yday = 0;
-		tim->tm_isdst = 0;
+		// utc time
+		if (tim != NULL && !DecodeGnssTime(date, utc, tim)) continue;
 
-		// Update tm_wday and tm_yday
-		mktime(tim);
+		located = true;
 	}
+	if (!located) return RET_ERR(false, E_UNKNOWN);
 
 	return RET_OK(true);
 }
 
 void WioLTE::SystemReset()
 {
+#if defined ARDUINO_ARCH_STM32F4 || defined ARDUINO_ARCH_STM32
 	NVIC_SystemReset();
+#endif
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////
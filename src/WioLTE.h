@@ -2,6 +2,7 @@
 
 #include "WioLTEConfig.h"
 #include "Internal/AtSerial.h"
+#include "Internal/Trace.h"
 #if defined ARDUINO_ARCH_STM32F4
 #include <Seeed_ws2812.h>
 #elif defined ARDUINO_ARCH_STM32
@@ -26,6 +27,9 @@
 #define WIO_TCP		(WioLTE::SOCKET_TCP)
 #define WIO_UDP		(WioLTE::SOCKET_UDP)
 
+#define WIO_SOCKET_READABLE	(WioLTE::SOCKET_EVENT_READABLE)
+#define WIO_SOCKET_CLOSED	(WioLTE::SOCKET_EVENT_CLOSED)
+
 #define WIO_D38		(WioLTE::D38)
 #define WIO_D39		(WioLTE::D39)
 #define WIO_D20		(WioLTE::D20)
@@ -43,6 +47,8 @@ public:
 		E_UNKNOWN,
 		E_TIMEOUT,
 		E_GNSS_NOT_FIXED,
+		E_MODULE_ERROR,		// See GetLastModuleError().
+		E_SEND_FAILED,
 	};
 
 	enum SocketType {
@@ -50,6 +56,11 @@ public:
 		SOCKET_UDP,
 	};
 
+	enum SocketEventType {
+		SOCKET_EVENT_READABLE	= 0x01,
+		SOCKET_EVENT_CLOSED		= 0x02,
+	};
+
 private:
 #if defined WIOLTE_SCHEMATIC_A
 	static const int MODULE_PWR_PIN = 18;		// PB2
@@ -94,6 +105,9 @@ private:
 
 #endif
 
+	static const int CONNECT_ID_NUM = 12;
+	static const int MODULE_DEFAULT_BAUD = 115200;
+
 public:
 	// D38 connector
 	static const int D38 = 38;
@@ -120,10 +134,48 @@ private:
 	WioSK6812 _Led;
 #endif
 	ErrorCodeType _LastErrorCode;
+	int _LastModuleError;
 	std::function<void(int)>_Delay;
+	int _ModuleBaud;
+	int _SocketSendWindow;
+
+	std::function<void(const char*)> _UrcFunction;
+
+	// Updated by URC handlers.
+	int _PacketGprsNetworkStat;		// <stat> of +CGREG, -1 when unknown.
+	int _PacketEpsNetworkStat;		// <stat> of +CEREG, -1 when unknown.
+	bool _SimReady;
+	int _ReceivedSMSIndex;		// First message in the storage, -2 when it is empty, -1 when unknown.
+	Stopwatch _ReceivedSMSStopwatch;	// Since the storage was last listed.
+
+	enum SocketState {
+		SOCKET_FREE,
+		SOCKET_OPENING,		// Waiting for +QIOPEN.
+		SOCKET_OPEN,
+		SOCKET_CLOSED,		// Closed by the peer or the network. The id is held until SocketClose().
+	};
 
-	bool _PacketGprsNetworkRegistration;
-	bool _PacketEpsNetworkRegistration;
+	struct SocketEntry {
+		SocketState State;
+		SocketType Type;
+		int OpenResult;		// +QIOPEN <err>, -1 while not reported.
+		bool OpenRecorded;	// The wait for +QIOPEN has been added to the statistics, or is not timed.
+		bool ReceivePending;
+		Stopwatch OpenStopwatch;	// Since AT+QIOPEN.
+	};
+
+	// Which connect ids are in use. Resynchronized with AT+QISTATE? only when it may differ from the module, e.g. after a reset.
+	SocketEntry _Sockets[CONNECT_ID_NUM];
+	bool _SocketTableSynced;
+
+	// Identity values do not change while the module is on.
+	bool _IdentityRead;
+	std::string _Revision;
+	std::string _Imei;
+	std::string _Imsi;
+	std::string _Iccid;
+	std::string _PhoneNumber;
+	bool _PhoneNumberRead;
 
 private:
 	bool ReturnOk(bool value)
@@ -138,23 +190,58 @@ private:
 	}
 	bool ReturnError(int lineNumber, bool value, ErrorCodeType errorCode);
 	int ReturnError(int lineNumber, int value, ErrorCodeType errorCode);
+	ErrorCodeType GetResponseError();
 
 	bool IsRespond();
+	bool ProbeBaud();
+	bool ScanBaud();
+	bool NegotiateBaud(long timeout);
+	bool WaitForRdy(long timeout);
 	bool Reset(long timeout);
 	bool TurnOn(long timeout);
 
+	void ClearIdentity();
+	void ReadIdentity();
+	bool ReadIdentityValue(const char* command, const AtPattern (&patterns)[2], std::string* value);
+	int CopyIdentity(const std::string& value, char* str, int size);
+
 	int GetFirstIndexOfReceivedSMS();
 
 	bool HttpSetUrl(const char* url);
 
+	bool SyncSocketTable();
+	bool SendSegment(int connectId, const byte* data, int dataSize);
+	bool QuerySocketUnread(const int* connectIds, int connectIdNum);
+	int GetSocketEvents(const int* connectIds, int* events, int connectIdNum);
+	void FreeSocket(int connectId);
+
+	void ClearUrcState();
+	void UrcQIURCRecv(const char* parameter);
+	void UrcQIURCClosed(const char* parameter);
+	void UrcQIURCPdpDeact(const char* parameter);
+	void UrcCMTI(const char* parameter);
+	void UrcCGREG(const char* parameter);
+	void UrcCEREG(const char* parameter);
+	void UrcQIOPEN(const char* parameter);
+	void UrcCPIN(const char* parameter);
+
 public:
 	bool ReadResponseCallback(const char* response);	// Internal use only.
 
 public:
 	WioLTE();
 	ErrorCodeType GetLastError() const;
+	int GetLastModuleError() const;		// <err> reported by the module when GetLastError() is E_MODULE_ERROR, -1 if none.
 	void SetDelayFunction(std::function<void(int)> func);
 	void SetDoWorkInWaitForAvailableFunction(std::function<void()> func);
+	void SetUrcFunction(std::function<void(const char*)> func);
+	void SetTranscriptFunction(std::function<void(const byte*, int)> func);
+	void SetModuleBaud(int baud);
+	void SetSocketSendWindow(int windowSize);	// Most unacknowledged bytes SocketWrite leaves on a TCP socket, 0 for no limit.
+	void GetStatistics(AtStatistics* statistics, bool clear = false);
+	int ReadTrace(Trace::Event* events, int eventNum);	// Needs WIO_TRACE.
+	unsigned long GetTraceLostNum();					// Needs WIO_TRACE. Events overwritten before they were read.
+	void PrintTrace();									// Needs WIO_TRACE.
 	void Init();
 	void PowerSupplyLTE(bool on);						// Keep compatibility
 	void PowerSupplyCellular(bool on);
@@ -194,6 +281,10 @@ public:
 	bool GetLocation(double* longitude, double* latitude);
 
 	int SocketOpen(const char* host, int port, SocketType type);
+	int SocketOpenAsync(const char* host, int port, SocketType type);	// connectId to pass to PollSocketOpen().
+	int PollSocketOpen(int connectId);									// 1 when open, 0 while opening, -1 on failure.
+	int SocketWrite(int connectId, const byte* data, int dataSize);	// Bytes accepted by the module, less than dataSize on failure.
+	bool GetSocketSendState(int connectId, int* sentSize, int* ackedSize, int* unackedSize);	// TCP counters from AT+QISEND=<id>,0. NULL skips a value.
 	bool SocketSend(int connectId, const byte* data, int dataSize);
 	bool SocketSend(int connectId, const char* data);
 	int SocketReceive(int connectId, byte* data, int dataSize);
@@ -201,6 +292,7 @@ public:
 	int SocketReceive(int connectId, byte* data, int dataSize, long timeout);
 	int SocketReceive(int connectId, char* data, int dataSize, long timeout);
 	bool SocketClose(int connectId);
+	int SocketPoll(const int* connectIds, int* events, int connectIdNum, long timeout);	// Sockets with SocketEventType bits set in events, 0 on timeout.
 
 	int HttpGet(const char* url, char* data, int dataSize, long timeout = 60000);
 	int HttpGet(const char* url, char* data, int dataSize, const WioLTEHttpHeader& header, long timeout = 60000);
@@ -63,9 +63,10 @@ size_t WioLTEClient::write(const uint8_t* buf, size_t size)
 {
 	if (!connected()) return 0;
 
-	if (!_Wio->SocketSend(_ConnectId, buf, size)) return 0;
+	int sentSize = _Wio->SocketWrite(_ConnectId, buf, size);
+	if (sentSize < 0) return 0;
 
-	return size;
+	return sentSize;
 }
 
 int WioLTEClient::available()
@@ -15,3 +15,8 @@
 #endif
 
 //#define WIO_DEBUG
+//#define WIO_TRACE
+
+#if defined WIO_DEBUG && !defined WIO_TRACE
+#define WIO_TRACE		// AT traffic is traced instead of printed; see WioLTE::PrintTrace().
+#endif
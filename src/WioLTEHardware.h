@@ -15,4 +15,9 @@ extern HardwareSerial SerialModule;
 extern HardwareSerial& SerialUART;
 extern TwoWire& WireI2C;
 
+#else
+
+// Host build: defined together with the Arduino shim.
+extern HardwareSerial& SerialModule;
+
 #endif